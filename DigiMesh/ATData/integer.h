@@ -26,15 +26,20 @@ public:
 
     operator int&(){return mInt;}
 
+    const T& Value() const
+    {
+        return mInt;
+    }
 
+
+    //!
+    //! \brief Numeric AT responses are big endian and only as long as the value needs
+    //!
     virtual void DeSerialize(const std::vector<uint8_t> &data){
-        throw "Not Implimented";
-        std::string str = "";
-        for(size_t i = 0 ; i < data.size()-1 ; i++) {
-            str += data[i];
+        mInt = 0;
+        for(size_t i = 0 ; i < data.size() ; i++) {
+            mInt = (T)((mInt << 8) | data[i]);
         }
-
-        this->mInt = std::stoi(str);
     }
 
     virtual std::vector<uint8_t> Serialize() const {
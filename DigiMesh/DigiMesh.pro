@@ -27,7 +27,9 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     serial_link.cpp \
-    digimesh_radio.cpp
+    digimesh_radio.cpp \
+    api_frame_parser.cpp \
+    scheduler.cpp
 
 HEADERS += \
     ATData/I_AT_data.h \
@@ -52,7 +54,16 @@ HEADERS += \
     serial_configuration.h \
     serial_link.h \
     timer.h \
-    ATData/transmit_status.h
+    ATData/transmit_status.h \
+    ring_buffer.h \
+    api_frame_parser.h \
+    frame_encoder.h \
+    frame_id_allocator.h \
+    timing_wheel.h \
+    scheduler.h \
+    at_command_future.h \
+    transmit_queue.h \
+    rate_limiter.h
 
 #win32:CONFIG(release, debug|release):       copydata.commands   = $(MKDIR) $$PWD/../lib ; $(COPY_DIR) release/*.dll $$PWD/../lib/
 #else:win32:CONFIG(debug, debug|release):    copydata.commands   = $(MKDIR) $$PWD/../lib ; $(COPY_DIR) $$OUT_PWD/debug/*.dll $$PWD/../lib/
@@ -0,0 +1,207 @@
+#include "api_frame_parser.h"
+
+#include <cstring>
+#include <cstdio>
+
+#define START_DELIMITER 0x7e
+#define ESCAPE_BYTE 0x7d
+#define ESCAPE_XOR 0x20
+
+ApiFrameParser::ApiFrameParser(size_t maxFrameLength) :
+    m_State(States::START),
+    m_Mode(APIModes::UNESCAPED),
+    m_EscapeNext(false),
+    m_Length(0),
+    m_Sum(0),
+    m_MaxFrameLength(maxFrameLength),
+    m_ChecksumErrors(0),
+    m_OversizedFrames(0),
+    m_DiscardedBytes(0)
+{
+    m_Frame.reserve(maxFrameLength);
+}
+
+
+void ApiFrameParser::SetFrameCallback(const std::function<void(const std::vector<uint8_t> &)> &func)
+{
+    m_FrameCallback = func;
+}
+
+
+void ApiFrameParser::SetMode(const APIModes &mode)
+{
+    m_Mode = mode;
+    Reset();
+}
+
+
+void ApiFrameParser::Parse(const uint8_t *buffer, size_t length)
+{
+    if(m_Mode == APIModes::ESCAPED)
+    {
+        parse_escaped(buffer, length);
+        return;
+    }
+
+    const uint8_t *end = buffer + length;
+
+    while(buffer < end)
+    {
+        switch(m_State)
+        {
+        case States::START:
+        {
+            //skip straight to the next start byte
+            const uint8_t *start = (const uint8_t*)std::memchr(buffer, START_DELIMITER, end - buffer);
+            if(start == NULL)
+            {
+                m_DiscardedBytes += end - buffer;
+                return;
+            }
+            m_DiscardedBytes += start - buffer;
+            buffer = start + 1;
+            m_State = States::LENGTH_MSB;
+            break;
+        }
+        case States::LENGTH_MSB:
+            m_Length = ((uint16_t)*buffer++) << 8;
+            m_State = States::LENGTH_LSB;
+            break;
+        case States::LENGTH_LSB:
+            m_Length |= *buffer++;
+            begin_body();
+            break;
+        case States::BODY:
+        {
+            //copy as much of the body as this chunk holds
+            size_t needed = m_Length - m_Frame.size();
+            size_t available = end - buffer;
+            size_t count = needed < available ? needed : available;
+            for(size_t i = 0 ; i < count ; i++)
+            {
+                m_Sum += buffer[i];
+            }
+            m_Frame.insert(m_Frame.end(), buffer, buffer + count);
+            buffer += count;
+            if(m_Frame.size() == m_Length)
+            {
+                m_State = States::CHECKSUM;
+            }
+            break;
+        }
+        case States::CHECKSUM:
+            m_Sum += *buffer++;
+            finish_frame();
+            break;
+        }
+    }
+}
+
+
+void ApiFrameParser::parse_escaped(const uint8_t *buffer, size_t length)
+{
+    for(size_t i = 0 ; i < length ; i++)
+    {
+        uint8_t byte = buffer[i];
+
+        //an unescaped start byte always begins a new frame
+        if(byte == START_DELIMITER)
+        {
+            if(m_State != States::START)
+            {
+                m_DiscardedBytes += 3 + m_Frame.size();
+            }
+            m_EscapeNext = false;
+            m_State = States::LENGTH_MSB;
+            continue;
+        }
+
+        if(m_State == States::START)
+        {
+            m_DiscardedBytes++;
+            continue;
+        }
+
+        if(byte == ESCAPE_BYTE)
+        {
+            m_EscapeNext = true;
+            continue;
+        }
+
+        if(m_EscapeNext)
+        {
+            byte ^= ESCAPE_XOR;
+            m_EscapeNext = false;
+        }
+
+        consume(byte);
+    }
+}
+
+
+void ApiFrameParser::consume(uint8_t byte)
+{
+    switch(m_State)
+    {
+    case States::START:
+        break;
+    case States::LENGTH_MSB:
+        m_Length = ((uint16_t)byte) << 8;
+        m_State = States::LENGTH_LSB;
+        break;
+    case States::LENGTH_LSB:
+        m_Length |= byte;
+        begin_body();
+        break;
+    case States::BODY:
+        m_Sum += byte;
+        m_Frame.push_back(byte);
+        if(m_Frame.size() == m_Length)
+        {
+            m_State = States::CHECKSUM;
+        }
+        break;
+    case States::CHECKSUM:
+        m_Sum += byte;
+        finish_frame();
+        break;
+    }
+}
+
+
+void ApiFrameParser::begin_body()
+{
+    if(m_Length == 0 || m_Length > m_MaxFrameLength)
+    {
+        m_OversizedFrames += m_Length != 0;
+        m_State = States::START;
+        return;
+    }
+    m_Frame.clear();
+    m_Sum = 0;
+    m_State = States::BODY;
+}
+
+
+void ApiFrameParser::finish_frame()
+{
+    m_State = States::START;
+    if(m_Sum != 0xFF)
+    {
+        m_ChecksumErrors++;
+        printf("Digimesh Checksum Failed! Ignoring packet.\n");
+        return;
+    }
+    if(m_FrameCallback)
+    {
+        m_FrameCallback(m_Frame);
+    }
+}
+
+
+void ApiFrameParser::Reset()
+{
+    m_State = States::START;
+    m_EscapeNext = false;
+    m_Frame.clear();
+}
@@ -0,0 +1,109 @@
+#ifndef API_FRAME_PARSER_H
+#define API_FRAME_PARSER_H
+
+#include "DigiMesh_global.h"
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+#include <functional>
+
+#include "api_modes.h"
+
+#define MAX_API_FRAME_LENGTH 1024
+
+//!
+//! \brief Resumable parser that pulls API frames out of a byte stream.
+//!
+//! Bytes can be handed over in chunks of any size, the parser keeps its state between calls and emits every frame
+//! that passes its checksum through the frame callback. The frame given to the callback starts at the frame type and
+//! excludes the checksum.
+//!
+//! The frame buffer is allocated once at construction, frames declaring a length above the maximum are discarded
+//! and the parser resynchronizes on the next start byte.
+//!
+//! In escaped mode escape sequences are undone as bytes arrive, and a start byte seen mid frame abandons the
+//! partial frame and begins a new one.
+//!
+class DIGIMESHSHARED_EXPORT ApiFrameParser
+{
+private:
+
+    enum class States
+    {
+        START,
+        LENGTH_MSB,
+        LENGTH_LSB,
+        BODY,
+        CHECKSUM
+    };
+
+    States m_State;
+    APIModes m_Mode;
+    bool m_EscapeNext;
+    uint16_t m_Length;
+    uint8_t m_Sum;
+    std::vector<uint8_t> m_Frame;
+    size_t m_MaxFrameLength;
+
+    std::function<void(const std::vector<uint8_t> &)> m_FrameCallback;
+
+    uint64_t m_ChecksumErrors;
+    uint64_t m_OversizedFrames;
+    uint64_t m_DiscardedBytes;
+
+public:
+
+    ApiFrameParser(size_t maxFrameLength = MAX_API_FRAME_LENGTH);
+
+    /**
+     * @brief Select if the incoming stream is escaped (AP=2) or not (AP=1)
+     * @param mode API mode the radio is operating in
+     */
+    void SetMode(const APIModes &mode);
+
+    /**
+     * @brief Set function to call with each complete frame
+     * @param func Function to call, the frame passed is only valid for the duration of the call
+     */
+    void SetFrameCallback(const std::function<void(const std::vector<uint8_t> &)> &func);
+
+    /**
+     * @brief Feed received bytes to the parser
+     * @param buffer Received bytes
+     * @param length Number of bytes
+     */
+    void Parse(const uint8_t *buffer, size_t length);
+
+    /**
+     * @brief Drop any partially received frame
+     */
+    void Reset();
+
+    uint64_t ChecksumErrors() const
+    {
+        return m_ChecksumErrors;
+    }
+
+    uint64_t OversizedFrames() const
+    {
+        return m_OversizedFrames;
+    }
+
+    uint64_t DiscardedBytes() const
+    {
+        return m_DiscardedBytes;
+    }
+
+private:
+
+    void parse_escaped(const uint8_t *buffer, size_t length);
+
+    void consume(uint8_t byte);
+
+    void begin_body();
+
+    void finish_frame();
+};
+
+#endif // API_FRAME_PARSER_H
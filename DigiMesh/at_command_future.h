@@ -0,0 +1,87 @@
+#ifndef AT_COMMAND_FUTURE_H
+#define AT_COMMAND_FUTURE_H
+
+#include <vector>
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+#include "frame-persistance/behaviors/base.h"
+
+//!
+//! \brief Pending result of an AT command issued through DigiMeshRadio::GetATParameter or SetATParameter.
+//!
+//! The result becomes ready when the radio's response arrives (or the collection period ends). If the command could
+//! not be sent, its deadline passes first, or it is cancelled, get() throws std::runtime_error.
+//!
+//! Waiting on the result from inside a radio message handler would block the thread the response has to arrive on,
+//! wait from another thread or chain work off the callback based API instead.
+//!
+template <typename T>
+class ATCommandFuture
+{
+private:
+
+    std::future<std::vector<T>> m_Future;
+    std::weak_ptr<FramePersistanceBehavior<>> m_Frame;
+    std::shared_ptr<std::promise<std::vector<T>>> m_Promise;
+
+public:
+
+    ATCommandFuture(const std::shared_ptr<std::promise<std::vector<T>>> &promise, const std::shared_ptr<FramePersistanceBehavior<>> &frame) :
+        m_Future(promise->get_future()),
+        m_Frame(frame),
+        m_Promise(promise)
+    {
+    }
+
+    ATCommandFuture(ATCommandFuture &&rhs) = default;
+    ATCommandFuture& operator=(ATCommandFuture &&rhs) = default;
+
+    //!
+    //! \brief Block until the result is available
+    //! \return Responses received for the command
+    //!
+    std::vector<T> get()
+    {
+        return m_Future.get();
+    }
+
+    void wait() const
+    {
+        m_Future.wait();
+    }
+
+    template <typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period> &duration) const
+    {
+        return m_Future.wait_for(duration);
+    }
+
+    template <typename Clock, typename Duration>
+    std::future_status wait_until(const std::chrono::time_point<Clock, Duration> &time) const
+    {
+        return m_Future.wait_until(time);
+    }
+
+    //!
+    //! \brief Stop waiting on the command, releasing its frame id
+    //!
+    //! Does nothing if the result is already available.
+    //!
+    void Cancel()
+    {
+        std::shared_ptr<FramePersistanceBehavior<>> frame = m_Frame.lock();
+        if(frame == NULL)
+        {
+            return;
+        }
+
+        std::shared_ptr<std::promise<std::vector<T>>> promise = m_Promise;
+        frame->AbortAndFinish([promise](){
+            promise->set_exception(std::make_exception_ptr(std::runtime_error("AT command cancelled")));
+        });
+    }
+};
+
+#endif // AT_COMMAND_FUTURE_H
@@ -3,16 +3,74 @@
 #include "serial_configuration.h"
 
 #include <iostream>
+#include <algorithm>
 
 
-DigiMeshRadio::DigiMeshRadio(const std::string &commPort, const DigiMeshBaudRates &baudRate) :
-    m_Link(NULL)
+//!
+//! \brief Build a transmit status for an outcome the radio itself never reports
+//!
+static ATData::TransmitStatus local_transmit_status(TransmitStatusTypes status)
 {
-    m_CurrentFrames = new Frame[CALLBACK_QUEUE_SIZE];
-    for(int i = 0 ; i < CALLBACK_QUEUE_SIZE ; i++) {
-        m_CurrentFrames[i].inUse = false;
+    ATData::TransmitStatus transmitStatus;
+    transmitStatus.retries = 0;
+    transmitStatus.status = status;
+    transmitStatus.disoveryRequired = DiscoveryTypes::NO_DISCOVERY_OVERHEAD;
+    return transmitStatus;
+}
+
+
+//!
+//! \brief Ceiling of the transmit rate, the payload the RF link carries or the bytes the serial port does if fewer
+//!
+static double transmit_rate_ceiling(const DigiMeshBaudRates &baudRate, int rfDataRate)
+{
+    // a UART byte takes 10 bits with its start and stop bits
+    double serialBytesPerSecond = (double)baudRate / 10;
+    double rfBytesPerSecond = rfDataRate * RF_PAYLOAD_EFFICIENCY / 8;
+    return std::min(serialBytesPerSecond, rfBytesPerSecond);
+}
+
+
+static void notify_expired(const std::vector<PendingFrame> &expired)
+{
+    for(size_t i = 0 ; i < expired.size() ; i++) {
+        if(expired.at(i).callback) {
+            expired.at(i).callback(local_transmit_status(TransmitStatusTypes::EXPIRED));
+        }
     }
-    m_PreviousFrame = 0;
+}
+
+
+/**
+ * @brief Constructor
+ *
+ * The radio's AP parameter is set to match the given mode, so frames are encoded and decoded accordingly.
+ * Transmit requests are paced at no more than the payload the RF link can carry, or the serial port if that is
+ * slower. SetTransmitRateLimit overrides the ceiling.
+ * @param commPort Port the radio is attached to
+ * @param baudRate Baud rate to communicate at
+ * @param apiMode [UNESCAPED] API mode to operate the radio in
+ * @param rfDataRate [DEFAULT_RF_DATA_RATE] RF data rate of the radio in bits per second
+ */
+DigiMeshRadio::DigiMeshRadio(const std::string &commPort, const DigiMeshBaudRates &baudRate, const APIModes &apiMode, int rfDataRate) :
+    m_Link(NULL),
+    m_APIMode(apiMode),
+    m_Encoder(apiMode),
+    m_FrameExpiry(CALLBACK_QUEUE_SIZE, FRAME_EXPIRY_SLOTS, std::chrono::milliseconds(FRAME_EXPIRY_RESOLUTION_MS)),
+    m_FrameTimeout(DEFAULT_FRAME_TIMEOUT_MS),
+    m_ExpiryTask(0),
+    m_TransmitQueue(DEFAULT_TRANSMIT_QUEUE_DEPTH, TransmitQueuePolicy::BLOCK, std::chrono::milliseconds(DEFAULT_TRANSMIT_BLOCK_TIMEOUT_MS)),
+    m_RetryTask(0),
+    m_RateLimiter(transmit_rate_ceiling(baudRate, rfDataRate), RATE_MIN_CAPACITY_BYTES)
+{
+    m_CurrentFrames = new Frame[CALLBACK_QUEUE_SIZE];
+    m_ExpiredFrames.reserve(CALLBACK_QUEUE_SIZE);
+    m_ExpiredGenerations.reserve(CALLBACK_QUEUE_SIZE);
+
+    m_Parser.SetFrameCallback([this](const std::vector<uint8_t> &frame){
+        handle_frame(frame);
+    });
+    m_Parser.SetMode(m_APIMode);
 
     SerialConfiguration config;
     config.setBaud(baudRate);
@@ -23,12 +81,42 @@ DigiMeshRadio::DigiMeshRadio(const std::string &commPort, const DigiMeshBaudRate
     config.setFlowControl(QSerialPort::NoFlowControl);
 
     m_Link = new SerialLink(config);
+    // Keep only a short backlog in the link, which drains first come first served. Everything beyond it waits in the
+    // transmit queue where classes are ordered.
+    m_Link->SetTransmitBacklogLimit((size_t)baudRate / 10 * TRANSMIT_BACKLOG_MS / 1000);
     m_Link->Connect();
 
     m_Link->AddListener(this);
+
+    // The AP frame is the first one sent and contains no byte that needs escaping, so the radio accepts it no matter
+    // which mode it is currently in.
+    SetATParameterAsync<ATData::Integer<uint8_t>>("AP", ATData::Integer<uint8_t>((int)m_APIMode));
 }
 
 DigiMeshRadio::~DigiMeshRadio() {
+    Scheduler::TaskID expiryTask;
+    {
+        std::lock_guard<std::mutex> lock(m_ExpiryMutex);
+        expiryTask = m_ExpiryTask;
+        m_ExpiryTask = 0;
+    }
+    // the lock can't be held here, a running tick needs it to finish
+    if(expiryTask != 0) {
+        Scheduler::Instance().Cancel(expiryTask);
+    }
+
+    Scheduler::TaskID retryTask;
+    {
+        // with the queue empty a running retry has nothing left to send and won't schedule another
+        std::lock_guard<std::mutex> lock(m_QueueMutex);
+        m_TransmitQueue.Clear();
+        retryTask = m_RetryTask;
+        m_RetryTask = 0;
+    }
+    if(retryTask != 0) {
+        Scheduler::Instance().Cancel(retryTask);
+    }
+
     delete[] m_CurrentFrames;
 
     if(m_Link != NULL) {
@@ -58,108 +146,221 @@ void DigiMeshRadio::SetNewDataCallback(std::function<void(const std::vector<uint
 }
 
 
-void DigiMeshRadio::ReceiveData(SerialLink *link_ptr, const std::vector<uint8_t> &buffer)
+/**
+ * @brief SetFrameTimeout
+ * Set how long a frame waits on its response before its id is released and its callback is notified of the
+ * timeout. Frames that collect responses for a period wait that period plus this timeout.
+ * @param timeoutMS Timeout in milliseconds
+ */
+void DigiMeshRadio::SetFrameTimeout(int timeoutMS)
 {
-    //add what we received to the current buffer.
+    std::lock_guard<std::mutex> lock(m_ExpiryMutex);
+    m_FrameTimeout = std::chrono::milliseconds(timeoutMS);
+}
+
 
-    m_CurrBuffMutex.lock();
-    for(size_t i = 0 ; i < buffer.size() ; i++) {
-        m_CurrBuf.push_back(buffer.at(i));
+/**
+ * @brief SetTransmitQueue
+ * Configure the queue that absorbs messages while every frame id is in use or the transmit buffer is full.
+ * Senders on the radio's thread or the scheduler's thread are never blocked, under TransmitQueuePolicy::BLOCK
+ * their messages are rejected when the queue is full.
+ * @param depth Number of messages that may wait at once
+ * @param policy Policy applied when a message arrives at a full queue
+ * @param blockTimeoutMS Longest a sender waits for room under TransmitQueuePolicy::BLOCK
+ */
+void DigiMeshRadio::SetTransmitQueue(size_t depth, TransmitQueuePolicy policy, int blockTimeoutMS)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_QueueMutex);
+        m_TransmitQueue.Configure(depth, policy, std::chrono::milliseconds(blockTimeoutMS));
     }
-    m_CurrBuffMutex.unlock();
+    m_QueueSpace.notify_all();
+}
 
 
-    //start infinite loop to pick up multiple packets sent at same time
-    while(true) {
+/**
+ * @brief TrySendMessage
+ * Send a message without throwing, the result reports whether it was accepted by the radio's transmit queue.
+ * @param data Payload to send
+ * @param addr [BROADCAST_ADDRESS] Address to send to
+ * @param callback [nullptr] Called with the transmit status
+ * @param priority [TELEMETRY] Class the message is queued in
+ * @param options [TransmitOptions()] Transmit options and broadcast radius of the request
+ * @return Whether the message was accepted
+ */
+TransmitQueueResult DigiMeshRadio::TrySendMessage(const std::vector<uint8_t> &data, const uint64_t &addr, const std::function<void(const ATData::TransmitStatus &)> &callback, TransmitPriority priority, const TransmitOptions &options)
+{
+    if(data.size() > MAX_API_FRAME_LENGTH - TRANSMIT_REQUEST_HEADER_LENGTH)
+    {
+        return TransmitQueueResult::PAYLOAD_TOO_LARGE;
+    }
 
-        m_CurrBuffMutex.lock();
+    PendingFrame dropped;
+    PendingFrame superseded;
+    std::vector<PendingFrame> expired;
+    {
+        std::unique_lock<std::mutex> lock(m_QueueMutex);
 
-        //if there aren't three bytes received we have to wait more
-        if(m_CurrBuf.size() < 3) {
-            m_CurrBuffMutex.unlock();
-            break;
+        // nothing is waiting ahead of this message, try it straight away so an idle radio never copies the payload
+        if(m_TransmitQueue.EmptyThrough(priority))
+        {
+            TransmitAttempt attempt = transmit_message(data, addr, callback, options);
+            if(attempt == TransmitAttempt::SENT)
+            {
+                m_TransmitQueue.CountImmediate(priority);
+                return TransmitQueueResult::ACCEPTED;
+            }
         }
 
+        PendingFrame frame;
+        frame.data = data;
+        frame.addr = addr;
+        frame.callback = callback;
+        frame.priority = priority;
+        frame.options = options;
+        frame.enqueued = std::chrono::steady_clock::now();
+        frame.deadline = frame.enqueued + options.timeToLive;
 
-        if(m_CurrBuf.at(0) != 0x7E) {
-            m_CurrBuf.erase(m_CurrBuf.begin());
-            m_CurrBuffMutex.unlock();
-            continue;
+        if(options.coalesceKey != 0 && m_TransmitQueue.Coalesce(frame))
+        {
+            superseded = std::move(frame);
         }
+        else
+        {
+            if(m_TransmitQueue.Full(priority))
+            {
+                switch(m_TransmitQueue.Policy())
+                {
+                case TransmitQueuePolicy::REJECT:
+                    return TransmitQueueResult::QUEUE_FULL;
+                case TransmitQueuePolicy::DROP_OLDEST:
+                    if(m_TransmitQueue.Empty(priority))
+                    {
+                        return TransmitQueueResult::QUEUE_FULL;
+                    }
+                    dropped = m_TransmitQueue.Drop(priority);
+                    break;
+                case TransmitQueuePolicy::BLOCK:
+                    // the queue only drains from these threads, waiting on them would never end
+                    if(m_Link->IsLinkThread() || Scheduler::Instance().IsSchedulerThread())
+                    {
+                        return TransmitQueueResult::QUEUE_FULL;
+                    }
+                    if(!m_QueueSpace.wait_for(lock, m_TransmitQueue.BlockTimeout(), [this, priority](){ return !m_TransmitQueue.Full(priority); }))
+                    {
+                        return TransmitQueueResult::TIMED_OUT;
+                    }
+                    break;
+                }
+            }
 
+            m_TransmitQueue.Push(std::move(frame));
 
+            // the queue may have drained while this sender waited, in which case nothing else would pump it
+            pump_locked(expired);
+        }
+    }
 
-        // add 4 bytes for start, length, and checksum
-        uint16_t packet_length = (((uint16_t)m_CurrBuf[1])<<8 | (uint16_t)m_CurrBuf[2]) + 4;
+    if(dropped.callback)
+    {
+        dropped.callback(local_transmit_status(TransmitStatusTypes::DROPPED));
+    }
+    if(superseded.callback)
+    {
+        superseded.callback(local_transmit_status(TransmitStatusTypes::SUPERSEDED));
+    }
+    notify_expired(expired);
+    return TransmitQueueResult::ACCEPTED;
+}
 
-        //if we have received part of the packet, but not entire thing then we need to wait longer
-        if(m_CurrBuf.size() < packet_length) {
-            m_CurrBuffMutex.unlock();
-            return;
-        }
 
-        //splice m_CurrBuff to just our packet we care about.
-        std::vector<uint8_t> packet(
-            std::make_move_iterator(m_CurrBuf.begin() + 3),
-            std::make_move_iterator(m_CurrBuf.begin() + packet_length - 1));
-        uint8_t checksum = m_CurrBuf.at(packet_length -1);
+/**
+ * @brief SetTransmitScheduling
+ * Set how the classes of queued messages share the link
+ * @param scheduling Scheduling policy
+ * @param weights [{}] Messages each class may send per round under TransmitSchedulingPolicy::WEIGHTED, indexed by
+ * TransmitPriority
+ */
+void DigiMeshRadio::SetTransmitScheduling(TransmitSchedulingPolicy scheduling, const std::vector<unsigned int> &weights)
+{
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    m_TransmitQueue.SetScheduling(scheduling, weights);
+}
 
-        /*
-        if(packet[0] == LEGACY_TX_STATUS)
-        {
-            for(int i = 0 ; i < m_CurrBuf.size() ; i++)
-            {
-                printf("%x\n", m_CurrBuf.at(i));
-            }
-            printf("Dumped\n");
-        }
-        */
 
-        m_CurrBuf.erase(m_CurrBuf.begin(), m_CurrBuf.begin() + packet_length);
+/**
+ * @brief GetTransmitQueueStats
+ * Get the depth and latency counters of one class of the transmit queue
+ * @param priority Class to get the counters of
+ * @return Counters
+ */
+TransmitQueueStats DigiMeshRadio::GetTransmitQueueStats(TransmitPriority priority)
+{
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    return m_TransmitQueue.Stats(priority);
+}
 
 
+/**
+ * @brief SetTransmitRateLimit
+ * Set the highest rate messages are handed to the radio at. The rate in use backs off from it while the radio reports
+ * congestion and recovers as transmissions succeed.
+ * @param bytesPerSecond Highest rate, 0 disables pacing
+ */
+void DigiMeshRadio::SetTransmitRateLimit(double bytesPerSecond)
+{
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    m_RateLimiter.SetCeiling(bytesPerSecond);
+}
 
-        m_CurrBuffMutex.unlock();
 
-        //check the checksum
-        uint8_t dataCheck = checksum;
-        for(auto it = packet.cbegin() ; it != packet.cend() ; ++it)
-        {
-            dataCheck += *it;
-        }
-        if(dataCheck != 0xFF)
-        {
-            printf("Digimesh Checksum Failed! Ignoring packet.\n");
-            continue;
-        }
+/**
+ * @brief GetTransmitRate
+ * Get the rate messages are currently paced at
+ * @return Rate in bytes per second
+ */
+double DigiMeshRadio::GetTransmitRate()
+{
+    std::lock_guard<std::mutex> lock(m_QueueMutex);
+    return m_RateLimiter.Rate();
+}
 
-        switch(packet[0])
-        {
-            case FRAME_AT_COMMAND_RESPONSE:
-                handle_AT_command_response(packet);
-                break;
-            case FRAME_REMOTE_AT_COMMAND_RESPONSE:
-                break;
-            case FRAME_MODEM_STATUS:
-                break;
-            case FRAME_TRANSMIT_STATUS:
-                handle_transmit_status(packet);
-                break;
-            case LEGACY_TX_STATUS:
-                handle_legacy_transmit_status(packet);
-                break;
-            case FRAME_RECEIVE_PACKET:
-                handle_receive_packet(packet);
-                break;
-            case FRAME_EXPLICIT_RECEIVE_PACKET:
-                handle_receive_packet(packet, true);
-                break;
-        default:
-            throw std::runtime_error("unknown packet type received: " + std::to_string(packet[0]));
-        }
 
+void DigiMeshRadio::ReceiveData(SerialLink *link_ptr, const uint8_t *buffer, size_t length)
+{
+    // bytes only ever arrive on the link's thread, so the parser needs no locking
+    m_Parser.Parse(buffer, length);
+}
 
 
+void DigiMeshRadio::handle_frame(const std::vector<uint8_t> &packet)
+{
+    switch(packet[0])
+    {
+        case FRAME_AT_COMMAND_RESPONSE:
+            handle_AT_command_response(packet);
+            break;
+        case FRAME_REMOTE_AT_COMMAND_RESPONSE:
+            break;
+        case FRAME_MODEM_STATUS:
+            break;
+        case FRAME_TRANSMIT_STATUS:
+            handle_transmit_status(packet);
+            break;
+        case LEGACY_TX_STATUS:
+            handle_legacy_transmit_status(packet);
+            break;
+        case FRAME_RECEIVE_PACKET:
+            handle_receive_packet(packet);
+            break;
+        case FRAME_EXPLICIT_RECEIVE_PACKET:
+            handle_receive_packet(packet, true);
+            break;
+        case FRAME_ROUTE_INFORMATION:
+            handle_route_information(packet);
+            break;
+    default:
+        throw std::runtime_error("unknown packet type received: " + std::to_string(packet[0]));
     }
 }
 
@@ -213,14 +414,9 @@ void DigiMeshRadio::handle_AT_command_response(const std::vector<uint8_t> &buf)
 
 void DigiMeshRadio::handle_transmit_status(const std::vector<uint8_t> &data)
 {
+    // a payload too large for the radio (0x74) is reported to the sender's callback like any other status
     uint8_t frame_id = data[1];
     find_and_invokve_frame(frame_id, data);
-
-    if(data[5] == 0x74)
-    {
-        printf(" PAYLOAD TOO LARGE !!!!\n");
-        throw std::runtime_error("Transmit error, Payload too large");
-    }
 }
 
 void DigiMeshRadio::handle_legacy_transmit_status(const std::vector<uint8_t> &data)
@@ -242,37 +438,261 @@ void DigiMeshRadio::handle_receive_packet(const std::vector<uint8_t> &data, cons
     }
 }
 
+
+static uint64_t read_address(const std::vector<uint8_t> &data, size_t offset)
+{
+    uint64_t addr = 0;
+    for(int i = 0 ; i < 8 ; i++) {
+        addr |= (((uint64_t)data[offset+i]) << (8*(7-i)));
+    }
+    return addr;
+}
+
+void DigiMeshRadio::handle_route_information(const std::vector<uint8_t> &data)
+{
+    if(data.size() < ROUTE_INFORMATION_LENGTH) {
+        return;
+    }
+
+    RouteInformation route;
+    route.sourceEvent = (RouteInformationEvents)data[1];
+    route.timestamp = ((uint32_t)data[3] << 24) | ((uint32_t)data[4] << 16) | ((uint32_t)data[5] << 8) | (uint32_t)data[6];
+    route.ackTimeouts = data[7];
+    route.transmitBlocked = data[8];
+    route.destination = read_address(data, 10);
+    route.source = read_address(data, 18);
+    route.responder = read_address(data, 26);
+    route.receiver = read_address(data, 34);
+
+    for(size_t i = 0 ; i < m_RouteInformationHandlers.size() ; i++) {
+        m_RouteInformationHandlers.at(i)(route);
+    }
+}
+
 int DigiMeshRadio::reserve_next_frame_id()
 {
-    std::lock_guard<std::mutex> lock(m_FrameSelectionMutex);
+    return m_FrameIds.Reserve();
+}
+
+
+DigiMeshRadio::TransmitAttempt DigiMeshRadio::transmit_message(const std::vector<uint8_t> &data, const uint64_t &addr, const std::function<void(const ATData::TransmitStatus &)> &callback, const TransmitOptions &options)
+{
+    int frame_id = 0;
+    if(callback)
+    {
+        frame_id = reserve_next_frame_id();
+        if(frame_id == -1)
+        {
+            return TransmitAttempt::NO_FRAME_ID;
+        }
+    }
+
+    // paced on the unescaped frame length, escaping only changes what the UART carries
+    const size_t cost = TRANSMIT_REQUEST_HEADER_LENGTH + data.size() + 4;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if(!m_RateLimiter.TryConsume(cost, now))
+    {
+        if(frame_id != 0)
+        {
+            release_frame(frame_id);
+        }
+        std::chrono::microseconds wait = m_RateLimiter.TimeUntil(cost, now);
+        schedule_transmit_retry((int)std::chrono::duration_cast<std::chrono::milliseconds>(wait).count() + 1);
+        return TransmitAttempt::NO_TOKENS;
+    }
 
-    // save last id
-    int framePrediction = m_PreviousFrame;
-    // advance until we find an empty slot
-    do {
-        framePrediction++;
+    uint8_t header[TRANSMIT_REQUEST_HEADER_LENGTH];
+    header[0] = FRAME_TRANSMIT_REQUEST;
+    header[1] = frame_id;
+    for(size_t i = 0 ; i < 8 ; i++) {
+        header[2+i] = (addr >> (8*(7-i))) & 0xFF;
+    }
+    header[10] = 0xFF;
+    header[11] = 0xFE;
+    header[12] = options.broadcastRadius;
+    header[13] = options.OptionsByte();
 
-        //wrap around
-        if (framePrediction > CALLBACK_QUEUE_SIZE-1){
-            framePrediction = 1;
+    if(frame_id != 0)
+    {
+        std::shared_ptr<FramePersistanceBehavior<ShutdownFirstResponse>> frameBehavior = std::make_shared<FramePersistanceBehavior<ShutdownFirstResponse>>(ShutdownFirstResponse());
+        ((FramePersistanceBehavior<>*)frameBehavior.get())->setCallback<ATData::TransmitStatus>([this, callback, now](const std::vector<ATData::TransmitStatus> &arr)
+        {
+            //no transmit status arriving before the frame expired is reported as a timeout
+            ATData::TransmitStatus status = arr.size() == 0 ? local_transmit_status(TransmitStatusTypes::TIMEOUT) : arr.at(0);
+            {
+                std::lock_guard<std::mutex> lock(m_QueueMutex);
+                m_RateLimiter.OnStatus(status.status, std::chrono::steady_clock::now() - now);
+            }
+            callback(status);
+        });
+
+        attach_frame_behavior(frame_id, frameBehavior);
+    }
+
+    if(!write_frame(header, TRANSMIT_REQUEST_HEADER_LENGTH, data.data(), data.size()))
+    {
+        // the message stays queued and gets a new frame id when it is retried
+        if(frame_id != 0)
+        {
+            std::atomic_store(&m_CurrentFrames[frame_id].framePersistance, std::shared_ptr<FramePersistanceBehavior<>>());
+            release_frame(frame_id);
+        }
+        m_RateLimiter.Refund(cost);
+        schedule_transmit_retry(TRANSMIT_RETRY_MS);
+        return TransmitAttempt::NO_BUFFER;
+    }
+    return TransmitAttempt::SENT;
+}
+
+
+size_t DigiMeshRadio::pump_locked(std::vector<PendingFrame> &expired)
+{
+    size_t sent = 0;
+    size_t expiredBefore = expired.size();
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    while(!m_TransmitQueue.Empty())
+    {
+        const PendingFrame &frame = m_TransmitQueue.Front();
+
+        // checked as the message leaves the queue, airtime is not spent on data the receiver would ignore
+        if(frame.Expired(now))
+        {
+            expired.push_back(m_TransmitQueue.Expire());
+            continue;
         }
 
-        // if we've gone all the way around, then we can't send
-        if (framePrediction == m_PreviousFrame)
+        // waiting on a frame id, the next released one pumps again, otherwise a retry has been scheduled
+        if(transmit_message(frame.data, frame.addr, frame.callback, frame.options) != TransmitAttempt::SENT)
         {
-            return -1;
+            break;
         }
+
+        m_TransmitQueue.Pop();
+        sent++;
+    }
+
+    if(sent > 0 || expired.size() > expiredBefore)
+    {
+        m_QueueSpace.notify_all();
     }
-    while (m_CurrentFrames[framePrediction].inUse == true);
+    return sent;
+}
 
-    m_CurrentFrames[framePrediction].inUse = true;
-    m_PreviousFrame = framePrediction;
 
-    return framePrediction;
+void DigiMeshRadio::pump_transmit_queue()
+{
+    std::vector<PendingFrame> expired;
+    {
+        std::lock_guard<std::mutex> lock(m_QueueMutex);
+        pump_locked(expired);
+    }
+    notify_expired(expired);
+}
+
+
+void DigiMeshRadio::schedule_transmit_retry(int delayMS)
+{
+    if(m_RetryTask != 0)
+    {
+        return;
+    }
+
+    m_RetryTask = Scheduler::Instance().Schedule(delayMS, [this](){
+        std::vector<PendingFrame> expired;
+        {
+            std::lock_guard<std::mutex> lock(m_QueueMutex);
+            m_RetryTask = 0;
+            pump_locked(expired);
+        }
+        notify_expired(expired);
+    });
+}
+
+
+void DigiMeshRadio::release_frame(int frame_id)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_ExpiryMutex);
+        m_FrameExpiry.Cancel(frame_id);
+        m_CurrentFrames[frame_id].generation++;
+    }
+    m_FrameIds.Release(frame_id);
 }
 
 
 void DigiMeshRadio::finish_frame(int frame_id)
 {
-    this->m_CurrentFrames[frame_id].inUse = false;
+    release_frame(frame_id);
+
+    // a message may have been waiting on this id
+    pump_transmit_queue();
+}
+
+
+void DigiMeshRadio::expire_frame(int frame_id, uint32_t generation)
+{
+    std::shared_ptr<FramePersistanceBehavior<>> framePersistance;
+    bool released = false;
+    {
+        std::lock_guard<std::mutex> lock(m_ExpiryMutex);
+
+        // answered and released since it expired, the id may already belong to another frame
+        if(m_CurrentFrames[frame_id].generation != generation) {
+            return;
+        }
+
+        framePersistance = std::atomic_load(&m_CurrentFrames[frame_id].framePersistance);
+        if(framePersistance == NULL || framePersistance->HasCallback() == false) {
+            // released under the lock, so no other release of this reservation can slip in between
+            m_CurrentFrames[frame_id].generation++;
+            m_FrameIds.Release(frame_id);
+            released = true;
+        }
+    }
+
+    if(released) {
+        pump_transmit_queue();
+    }
+    else {
+        // releases the frame id through the finish behavior, does nothing if the frame finished meanwhile
+        framePersistance->TimeoutAndFinish();
+    }
+}
+
+
+void DigiMeshRadio::tick_frame_expiry()
+{
+    std::vector<int> expired;
+    std::vector<uint32_t> generations;
+    {
+        std::lock_guard<std::mutex> lock(m_ExpiryMutex);
+        m_FrameExpiry.Advance(std::chrono::steady_clock::now(), m_ExpiredFrames);
+        m_ExpiredGenerations.clear();
+        for(size_t i = 0 ; i < m_ExpiredFrames.size() ; i++) {
+            m_ExpiredGenerations.push_back(m_CurrentFrames[m_ExpiredFrames.at(i)].generation);
+        }
+        expired.swap(m_ExpiredFrames);
+        generations.swap(m_ExpiredGenerations);
+
+        // stop ticking once nothing is pending, the next reserved frame starts it again
+        if(m_FrameExpiry.Empty() && m_ExpiryTask != 0) {
+            Scheduler::Instance().Cancel(m_ExpiryTask);
+            m_ExpiryTask = 0;
+        }
+    }
+
+    for(size_t i = 0 ; i < expired.size() ; i++) {
+        expire_frame(expired.at(i), generations.at(i));
+    }
+
+    // hand the storage back so the next tick doesn't allocate
+    expired.clear();
+    generations.clear();
+    std::lock_guard<std::mutex> lock(m_ExpiryMutex);
+    if(m_ExpiredFrames.capacity() < expired.capacity()) {
+        m_ExpiredFrames.swap(expired);
+    }
+    if(m_ExpiredGenerations.capacity() < generations.capacity()) {
+        m_ExpiredGenerations.swap(generations);
+    }
 }
@@ -5,9 +5,21 @@
 #include <vector>
 #include <map>
 #include <functional>
+#include <mutex>
+#include <condition_variable>
 #include "digi_mesh_baud_rates.h"
+#include "api_modes.h"
+#include "route_information.h"
 
 #include "serial_link.h"
+#include "api_frame_parser.h"
+#include "frame_encoder.h"
+#include "frame_id_allocator.h"
+#include "timing_wheel.h"
+#include "scheduler.h"
+#include "at_command_future.h"
+#include "transmit_queue.h"
+#include "rate_limiter.h"
 
 #include "i_link_events.h"
 
@@ -19,7 +31,6 @@
 #include "callback.h"
 
 
-#define START_BYTE 0x7e
 #define BROADCAST_ADDRESS 0x000000000000ffff
 // command types
 #define FRAME_AT_COMMAND 0x08
@@ -32,19 +43,43 @@
 #define FRAME_TRANSMIT_STATUS 0x8b
 #define FRAME_RECEIVE_PACKET 0x90
 #define FRAME_EXPLICIT_RECEIVE_PACKET 0x91
+#define FRAME_ROUTE_INFORMATION 0x8d
+#define ROUTE_INFORMATION_LENGTH 42
 #define CALLBACK_QUEUE_SIZE 256
+#define TRANSMIT_REQUEST_HEADER_LENGTH 14
+#define AT_COMMAND_HEADER_LENGTH 4
+#define DEFAULT_FRAME_TIMEOUT_MS 10000
+#define FRAME_EXPIRY_RESOLUTION_MS 100
+#define FRAME_EXPIRY_SLOTS 128
+#define DEFAULT_TRANSMIT_QUEUE_DEPTH 64
+#define DEFAULT_TRANSMIT_BLOCK_TIMEOUT_MS 1000
+#define TRANSMIT_RETRY_MS 5
+#define TRANSMIT_BACKLOG_MS 250
+#define RATE_MIN_CAPACITY_BYTES 256
+// RF data rate in bits per second of the XBee-PRO 900HP at its default BR setting of 1, from Digi's datasheet. The
+// 900HP runs at 10 kbps with BR set to 0 and 2.4 GHz DigiMesh modules at 250 kbps, pass theirs to the constructor.
+#define DEFAULT_RF_DATA_RATE 200000
+// Share of the RF data rate left for payload once preamble, MAC and mesh headers, acknowledgements and retries are
+// taken out. A rough allowance, the rate limiter backs off below it on its own when the radio reports congestion.
+#define RF_PAYLOAD_EFFICIENCY 0.5
 
 class DIGIMESHSHARED_EXPORT DigiMeshRadio : public ILinkEvents
 {
 private:
 
     struct Frame{
+        // written by sending threads and read on the link thread, only accessed through std::atomic_load/store
         std::shared_ptr<FramePersistanceBehavior<>> framePersistance;
-        bool inUse;
+        // bumped each time the id is released, guarded by m_ExpiryMutex. An expiry only applies to the reservation
+        // it was taken from.
+        uint32_t generation = 0;
     };
 
     SerialLink *m_Link;
 
+    APIModes m_APIMode;
+    FrameEncoder m_Encoder;
+
     std::vector<int> m_OwnVehicles;
     std::map<int, int> m_RemoteVehiclesToAddress;
 
@@ -52,16 +87,45 @@ private:
     std::function<void(const std::vector<uint8_t> &)> m_NewDataCallback;
 
     Frame *m_CurrentFrames;
-    int m_PreviousFrame;
-    std::mutex m_FrameSelectionMutex;
+    FrameIdAllocator m_FrameIds;
+
+    // deadlines of reserved frame ids, guarded by m_ExpiryMutex and turned by a periodic Scheduler task that only
+    // exists while deadlines are pending
+    TimingWheel m_FrameExpiry;
+    std::vector<int> m_ExpiredFrames;
+    std::vector<uint32_t> m_ExpiredGenerations;
+    std::chrono::milliseconds m_FrameTimeout;
+    std::mutex m_ExpiryMutex;
+    Scheduler::TaskID m_ExpiryTask;
+
+    // messages waiting on a frame id or transmit buffer space, guarded by m_QueueMutex. The queue is pumped whenever a
+    // frame id is released, and by a one shot retry task while the link's transmit buffer is full.
+    TransmitQueue m_TransmitQueue;
+    std::mutex m_QueueMutex;
+    std::condition_variable m_QueueSpace;
+    Scheduler::TaskID m_RetryTask;
+
+    // paces transmit requests, guarded by m_QueueMutex
+    RateLimiter m_RateLimiter;
 
-    std::vector<uint8_t> m_CurrBuf;
-    std::mutex m_CurrBuffMutex;
+    ApiFrameParser m_Parser;
 
     std::vector<std::function<void(const ATData::Message&)>> m_MessageHandlers;
+    std::vector<std::function<void(const RouteInformation&)>> m_RouteInformationHandlers;
 
 public:
-    DigiMeshRadio(const std::string &commPort, const DigiMeshBaudRates &baudRate);
+    /**
+     * @brief Constructor
+     *
+     * The radio's AP parameter is set to match the given mode, so frames are encoded and decoded accordingly.
+     * Transmit requests are paced at no more than the payload the RF link can carry, or the serial port if that is
+     * slower. SetTransmitRateLimit overrides the ceiling.
+     * @param commPort Port the radio is attached to
+     * @param baudRate Baud rate to communicate at
+     * @param apiMode [UNESCAPED] API mode to operate the radio in
+     * @param rfDataRate [DEFAULT_RF_DATA_RATE] RF data rate of the radio in bits per second
+     */
+    DigiMeshRadio(const std::string &commPort, const DigiMeshBaudRates &baudRate, const APIModes &apiMode = APIModes::UNESCAPED, int rfDataRate = DEFAULT_RF_DATA_RATE);
 
     ~DigiMeshRadio();
 
@@ -80,11 +144,33 @@ public:
      */
     void SetNewDataCallback(std::function<void(const std::vector<uint8_t> &)> func);
 
+    /**
+     * @brief SetFrameTimeout
+     * Set how long a frame waits on its response before its id is released and its callback is notified of the
+     * timeout. Frames that collect responses for a period wait that period plus this timeout.
+     * @param timeoutMS Timeout in milliseconds
+     */
+    void SetFrameTimeout(int timeoutMS);
+
     void AddMessageHandler(const std::function<void(const ATData::Message&)> &lambda)
     {
         m_MessageHandlers.push_back(lambda);
     }
 
+    /**
+     * @brief AddRouteInformationHandler
+     * Add a handler called on the link thread with every hop reported for messages sent with
+     * TransmitOptions::traceRoute, and every route repair the radio reports. The handler is added on the link thread,
+     * so it may be added while frames are being received.
+     * @param lambda Handler to add
+     */
+    void AddRouteInformationHandler(const std::function<void(const RouteInformation&)> &lambda)
+    {
+        RunOnLinkThread([this, lambda](){
+            m_RouteInformationHandlers.push_back(lambda);
+        });
+    }
+
 
     template <typename T, typename P>
     void GetATParameterAsync(const std::string &parameterName, const std::function<void(const std::vector<T> &)> &callback, const P &persistance = P())
@@ -94,38 +180,57 @@ public:
         std::shared_ptr<FramePersistanceBehavior<P>> frameBehavior = std::make_shared<FramePersistanceBehavior<P>>(persistance);
         ((FramePersistanceBehavior<>*)frameBehavior.get())->setCallback<T>(callback);
 
-        int frame_id = AT_command_helper(parameterName, frameBehavior);
+        AT_command_helper(parameterName, frameBehavior);
     }
 
 
-    template <typename T, typename P>
-    std::vector<T> GetATParameterSync(const std::string &parameterName, const P &persistance = P())
+    /**
+     * @brief Query an AT parameter without blocking
+     *
+     * Any number of queries may be outstanding at once, each is resolved independently.
+     * @param parameterName Two character AT command
+     * @param timeoutMS [-1] Time to wait on the response, -1 uses the radio's frame timeout
+     * @param persistance Behavior deciding when the query is complete
+     * @return Future resolving to the responses, throws from get() if the query can't be sent, times out or is cancelled
+     */
+    template <typename T, typename P = ShutdownFirstResponse>
+    ATCommandFuture<T> GetATParameter(const std::string &parameterName, int timeoutMS = -1, const P &persistance = P())
     {
-        std::mutex locker;
-        locker.lock();
-
-        std::vector<T> rtn;
-        GetATParameterAsync<T, P>(parameterName, [&rtn, &locker](const std::vector<T> &data){
-            rtn = data;
-            locker.unlock();
-        }, persistance);
+        static_assert(std::is_base_of<ATData::IATData, T>::value, "T must be a descendant of ATDATA::IATDATA");
 
-        locker.lock();
-        return rtn;
+        std::shared_ptr<FramePersistanceBehavior<P>> frameBehavior = std::make_shared<FramePersistanceBehavior<P>>(persistance);
+        return AT_command_future<T>(parameterName, frameBehavior, timeoutMS);
     }
 
+    /**
+     * @brief Set an AT parameter without blocking
+     * @param parameterName Two character AT command
+     * @param value Value to set
+     * @param timeoutMS [-1] Time to wait on the response, -1 uses the radio's frame timeout
+     * @return Future that is ready once the radio acknowledged the command, throws from get() if the command can't be
+     * sent, times out or is cancelled
+     */
     template <typename T>
-    void SetATParameterSync(const std::string &parameterName, const T &value){
+    ATCommandFuture<ATData::Void> SetATParameter(const std::string &parameterName, const T &value, int timeoutMS = -1)
+    {
+        static_assert(std::is_base_of<ATData::IATData, T>::value, "T must be a descendant of ATDATA::IATDATA");
 
-        //create mutex and lock it
-        std::mutex waitMutex;
-        waitMutex.lock();
+        std::shared_ptr<FramePersistanceBehavior<ShutdownFirstResponse>> frameBehavior = std::make_shared<FramePersistanceBehavior<ShutdownFirstResponse>>(ShutdownFirstResponse());
+        return AT_command_future<ATData::Void>(parameterName, frameBehavior, timeoutMS, value.Serialize());
+    }
 
-        //call function, unlock mutex in callback
-        SetATParameterAsync<T>(parameterName, value, [&waitMutex](){waitMutex.unlock();});
 
-        //lock mutex again, blocking this until above is called
-        waitMutex.lock();
+    template <typename T, typename P>
+    std::vector<T> GetATParameterSync(const std::string &parameterName, const P &persistance = P())
+    {
+        check_not_link_thread();
+        return GetATParameter<T, P>(parameterName, -1, persistance).get();
+    }
+
+    template <typename T>
+    void SetATParameterSync(const std::string &parameterName, const T &value){
+        check_not_link_thread();
+        SetATParameter<T>(parameterName, value).get();
     }
 
     template <typename T>
@@ -150,81 +255,141 @@ public:
         AT_command_helper(parameterName, frameBehavior, data);
     }
 
+    /**
+     * @brief SetTransmitQueue
+     * Configure the queue that absorbs messages while every frame id is in use or the transmit buffer is full.
+     * Senders on the radio's thread or the scheduler's thread are never blocked, under TransmitQueuePolicy::BLOCK
+     * their messages are rejected when the queue is full.
+     * @param depth Number of messages that may wait at once
+     * @param policy Policy applied when a message arrives at a full queue
+     * @param blockTimeoutMS Longest a sender waits for room under TransmitQueuePolicy::BLOCK
+     */
+    void SetTransmitQueue(size_t depth, TransmitQueuePolicy policy, int blockTimeoutMS = DEFAULT_TRANSMIT_BLOCK_TIMEOUT_MS);
+
+    /**
+     * @brief TrySendMessage
+     * Send a message without throwing, the result reports whether it was accepted by the radio's transmit queue.
+     * @param data Payload to send
+     * @param addr [BROADCAST_ADDRESS] Address to send to
+     * @param callback [nullptr] Called with the transmit status
+     * @param priority [TELEMETRY] Class the message is queued in
+     * @param options [TransmitOptions()] Transmit options and broadcast radius of the request
+     * @return Whether the message was accepted
+     */
+    TransmitQueueResult TrySendMessage(const std::vector<uint8_t> &data, const uint64_t &addr = BROADCAST_ADDRESS, const std::function<void(const ATData::TransmitStatus &)> &callback = nullptr, TransmitPriority priority = TransmitPriority::TELEMETRY, const TransmitOptions &options = TransmitOptions());
+
+    /**
+     * @brief SetTransmitScheduling
+     * Set how the classes of queued messages share the link
+     * @param scheduling Scheduling policy
+     * @param weights [{}] Messages each class may send per round under TransmitSchedulingPolicy::WEIGHTED, indexed by
+     * TransmitPriority
+     */
+    void SetTransmitScheduling(TransmitSchedulingPolicy scheduling, const std::vector<unsigned int> &weights = {});
+
+    /**
+     * @brief GetTransmitQueueStats
+     * Get the depth and latency counters of one class of the transmit queue
+     * @param priority Class to get the counters of
+     * @return Counters
+     */
+    TransmitQueueStats GetTransmitQueueStats(TransmitPriority priority);
+
+    /**
+     * @brief SetTransmitRateLimit
+     * Set the highest rate messages are handed to the radio at. The rate in use backs off from it while the radio
+     * reports congestion and recovers as transmissions succeed.
+     * @param bytesPerSecond Highest rate, 0 disables pacing
+     */
+    void SetTransmitRateLimit(double bytesPerSecond);
+
+    /**
+     * @brief GetTransmitRate
+     * Get the rate messages are currently paced at
+     * @return Rate in bytes per second
+     */
+    double GetTransmitRate();
+
+    /**
+     * @brief RunOnLinkThread
+     * Run a function on the thread received messages are handled on, straight away if called from it
+     * @param func Function to run
+     */
+    void RunOnLinkThread(const std::function<void()> &func)
+    {
+        m_Link->MarshalOnThread(func);
+    }
+
     void SendMessage(const std::vector<uint8_t> &data)
     {
-        std::shared_ptr<FramePersistanceBehavior<ShutdownFirstResponse>> frameBehavior = std::make_shared<FramePersistanceBehavior<ShutdownFirstResponse>>(ShutdownFirstResponse());
-        construct_message(data, BROADCAST_ADDRESS, frameBehavior);
+        SendMessage(data, BROADCAST_ADDRESS, nullptr);
     }
 
     void SendMessage(const std::vector<uint8_t> &data, const uint64_t &addr)
     {
-        std::shared_ptr<FramePersistanceBehavior<ShutdownFirstResponse>> frameBehavior = std::make_shared<FramePersistanceBehavior<ShutdownFirstResponse>>(ShutdownFirstResponse());
-        construct_message(data, addr, frameBehavior);
+        SendMessage(data, addr, nullptr);
     }
 
-    void SendMessage(const std::vector<uint8_t> &data, const uint64_t &addr, const std::function<void(const ATData::TransmitStatus &)> &callback)
+    void SendMessage(const std::vector<uint8_t> &data, const uint64_t &addr, const TransmitOptions &options)
     {
-        std::shared_ptr<FramePersistanceBehavior<ShutdownFirstResponse>> frameBehavior = std::make_shared<FramePersistanceBehavior<ShutdownFirstResponse>>(ShutdownFirstResponse());
-        ((FramePersistanceBehavior<>*)frameBehavior.get())->setCallback<ATData::TransmitStatus>([callback](const std::vector<ATData::TransmitStatus> &arr)
-        {
-            callback(arr.at(0));
-        });
-
-        construct_message(data, addr, frameBehavior);
+        SendMessage(data, addr, nullptr, TransmitPriority::TELEMETRY, options);
     }
 
-
-
-private:
-
-
-    void construct_message(const std::vector<uint8_t> &data, const uint64_t &addr, const std::shared_ptr<FramePersistanceBehavior<ShutdownFirstResponse>> &frameBehavior)
+    void SendMessage(const std::vector<uint8_t> &data, const uint64_t &addr, const std::function<void(const ATData::TransmitStatus &)> &callback, TransmitPriority priority = TransmitPriority::TELEMETRY, const TransmitOptions &options = TransmitOptions())
     {
-        int packet_length = 14 + data.size();
-        int total_length = packet_length+4;
-        char *tx_buf = new char[total_length];
-
-        int frame_id = 0;
-        if(frameBehavior->HasCallback())
+        switch(TrySendMessage(data, addr, callback, priority, options))
         {
-            frame_id = reserve_next_frame_id();
-        }
-        if(frame_id == -1)
-        {
-            throw std::runtime_error("Digimesh frame could not be established. Communication rate is likely too high for network to handle");
+        case TransmitQueueResult::ACCEPTED:
+            break;
+        case TransmitQueueResult::PAYLOAD_TOO_LARGE:
+            throw std::runtime_error("Transmit error, Payload too large");
+        case TransmitQueueResult::QUEUE_FULL:
+            throw std::runtime_error("Digimesh message could not be queued. Transmit queue is full");
+        case TransmitQueueResult::TIMED_OUT:
+            throw std::runtime_error("Digimesh message could not be queued. Timed out waiting on the transmit queue");
         }
+    }
 
-        tx_buf[0] = START_BYTE;
-        tx_buf[1] = (packet_length >> 8) & 0xFF;
-        tx_buf[2] = packet_length & 0xFF;
-        tx_buf[3] = FRAME_TRANSMIT_REQUEST;
-        tx_buf[4] = frame_id;
-        for(size_t i = 0 ; i < 8 ; i++) {
-            uint64_t a = (addr & (0xFFll << (8*(7-i)))) >> (8*(7-i));
-            tx_buf[5+i] = (char)a;
-        }
-        tx_buf[13] = 0xFF;
-        tx_buf[14] = 0xFe;
-        tx_buf[15] = 0x00;
-        tx_buf[16] = 0x00;
-        for(size_t i = 0 ; i < data.size() ; i++) {
-            tx_buf[17+i] = data.at(i);
-        }
-        tx_buf[total_length-1] = MathHelper::calc_checksum(tx_buf, 3, total_length-1);
 
-        frameBehavior->setFinishBehavior([this, frame_id](){
-            m_CurrentFrames[frame_id].inUse = false;
-        });
 
-        m_Link->MarshalOnThread([this, tx_buf, total_length, frame_id, frameBehavior](){
-            m_CurrentFrames[frame_id].framePersistance = frameBehavior;
-            m_Link->WriteBytes(tx_buf, total_length);
+private:
 
-            delete[] tx_buf;
-        });
-    }
+    enum class TransmitAttempt
+    {
+        SENT,
+        NO_FRAME_ID,
+        NO_TOKENS,
+        NO_BUFFER
+    };
 
-    virtual void ReceiveData(SerialLink *link_ptr, const std::vector<uint8_t> &buffer);
+    //!
+    //! \brief Encode a transmit request and hand it to the link
+    //!
+    //! Messages without a callback are sent with frame id 0, so the radio sends no status back and nothing is
+    //! allocated to track them. m_QueueMutex must be held.
+    //! \return Whether the message was sent, or what it is waiting on. A retry is scheduled unless it is waiting on a
+    //! frame id.
+    //!
+    TransmitAttempt transmit_message(const std::vector<uint8_t> &data, const uint64_t &addr, const std::function<void(const ATData::TransmitStatus &)> &callback, const TransmitOptions &options);
+
+    //!
+    //! \brief Send queued messages in order until one can't be sent, m_QueueMutex must be held
+    //!
+    //! Messages whose time to live passed are taken off the queue instead of being sent.
+    //! \param expired Receives the expired messages, their callbacks are to be notified once the lock is released
+    //! \return Number of messages sent
+    //!
+    size_t pump_locked(std::vector<PendingFrame> &expired);
+
+    void pump_transmit_queue();
+
+    //!
+    //! \brief Pump again once the link has drained some of its transmit buffer or tokens have accrued, m_QueueMutex
+    //! must be held
+    //!
+    void schedule_transmit_retry(int delayMS);
+
+    virtual void ReceiveData(SerialLink *link_ptr, const uint8_t *buffer, size_t length);
 
     virtual void CommunicationError(const SerialLink* link_ptr, const std::string &type, const std::string &msg);
 
@@ -236,49 +401,120 @@ private:
 
 private:
 
-    int AT_command_helper(const std::string &parameterName, const std::shared_ptr<FramePersistanceBehavior<>> &frameBehavior, const std::vector<uint8_t> &data = {})
+    template <typename T>
+    ATCommandFuture<T> AT_command_future(const std::string &parameterName, const std::shared_ptr<FramePersistanceBehavior<>> &frameBehavior, int timeoutMS, const std::vector<uint8_t> &data = {})
+    {
+        std::shared_ptr<std::promise<std::vector<T>>> promise = std::make_shared<std::promise<std::vector<T>>>();
+
+        frameBehavior->setCallback<T>([promise](const std::vector<T> &responses){
+            promise->set_value(responses);
+        });
+        frameBehavior->setTimeoutBehavior([promise, parameterName](){
+            promise->set_exception(std::make_exception_ptr(std::runtime_error("AT command " + parameterName + " timed out")));
+        });
+
+        ATCommandFuture<T> future(promise, frameBehavior);
+        AT_command_helper(parameterName, frameBehavior, data, timeoutMS, [promise, parameterName](const std::string &reason){
+            promise->set_exception(std::make_exception_ptr(std::runtime_error("AT command " + parameterName + " could not be sent, " + reason)));
+        });
+        return future;
+    }
+
+    //!
+    //! \brief Send an AT command frame
+    //!
+    //! Never throws. If no frame id is free or the transmit buffer is full, the command fails straight away. It is
+    //! finished through onFailure if given, otherwise as if it had timed out. Finishing releases any frame id it holds.
+    //! \param onFailure [nullptr] Called with the reason the command could not be sent
+    //!
+    void AT_command_helper(const std::string &parameterName, const std::shared_ptr<FramePersistanceBehavior<>> &frameBehavior, const std::vector<uint8_t> &data = {}, int timeoutMS = -1, const std::function<void(const std::string &)> &onFailure = nullptr)
     {
+        std::string failure;
+
         int frame_id = reserve_next_frame_id();
         if(frame_id == -1)
         {
-            throw std::runtime_error("Digimesh frame could not be established. Communication rate is likely too high for network to handle");
+            failure = "no frame id is free";
         }
+        else
+        {
+            uint8_t header[AT_COMMAND_HEADER_LENGTH];
+            header[0] = FRAME_AT_COMMAND;
+            header[1] = frame_id;
+            header[2] = parameterName[0];
+            header[3] = parameterName[1];
 
-        size_t param_len = data.size();
-
-        char *tx_buf = new char[8 + param_len];
-        tx_buf[0] = START_BYTE;
-        tx_buf[1] = (0x04 + param_len) >> 8;
-        tx_buf[2] = (0x04 + param_len) & 0xff;
-        tx_buf[3] = FRAME_AT_COMMAND;
-        tx_buf[4] = frame_id;
-        tx_buf[5] = parameterName[0];
-        tx_buf[6] = parameterName[1];
-
-        // if we have a parameter, copy it over
-        if (param_len > 0) {
-            for(size_t i = 0 ; i < param_len ; i++) {
-                tx_buf[7 + i] = data[i];
+            attach_frame_behavior(frame_id, frameBehavior, timeoutMS);
+
+            if(!write_frame(header, AT_COMMAND_HEADER_LENGTH, data.data(), data.size()))
+            {
+                failure = "the transmit buffer is full";
             }
         }
 
-        tx_buf[7 + param_len] = MathHelper::calc_checksum<char>(tx_buf, 3, 8 + param_len-1);
+        if(failure.empty())
+        {
+            return;
+        }
 
+        if(onFailure)
+        {
+            frameBehavior->AbortAndFinish([onFailure, failure](){
+                onFailure(failure);
+            });
+        }
+        else
+        {
+            frameBehavior->TimeoutAndFinish();
+        }
+    }
+
+    void attach_frame_behavior(int frame_id, const std::shared_ptr<FramePersistanceBehavior<>> &frameBehavior, int timeoutMS = -1)
+    {
         frameBehavior->setFinishBehavior([this, frame_id](){
-            m_CurrentFrames[frame_id].inUse = false;
+            finish_frame(frame_id);
         });
 
-        //console.log(tx_buf.toString('hex').replace(/(.{2})/g, "$1 "));
-        m_Link->MarshalOnThread([this, tx_buf, param_len, frame_id, frameBehavior](){
-            m_CurrentFrames[frame_id].framePersistance = frameBehavior;
-            m_Link->WriteBytes(tx_buf, 8 + param_len);
+        // attached before the frame is written, so a response can never arrive ahead of it
+        std::atomic_store(&m_CurrentFrames[frame_id].framePersistance, frameBehavior);
+        frameBehavior->Started();
+
+        std::lock_guard<std::mutex> lock(m_ExpiryMutex);
+        std::chrono::milliseconds timeout = timeoutMS < 0 ? m_FrameTimeout : std::chrono::milliseconds(timeoutMS);
+        m_FrameExpiry.Schedule(frame_id, timeout + std::chrono::milliseconds(frameBehavior->LifetimeMS()));
+        if(m_ExpiryTask == 0)
+        {
+            m_ExpiryTask = Scheduler::Instance().SchedulePeriodic(m_FrameExpiry.Resolution().count(), [this](){
+                tick_frame_expiry();
+            });
+        }
+    }
 
-            delete[] tx_buf;
+    //!
+    //! \brief Encode a frame into the link's transmit ring
+    //! \return False if the ring was full, the caller still owns any frame id the frame carries
+    //!
+    bool write_frame(const uint8_t *header, size_t headerLength, const uint8_t *payload, size_t payloadLength)
+    {
+        const FrameEncoder &encoder = m_Encoder;
+        return m_Link->WriteFrame(m_Encoder.MaxEncodedLength(headerLength + payloadLength), [&encoder, header, headerLength, payload, payloadLength](RingBuffer &ring){
+            encoder.Encode(ring, header, headerLength, payload, payloadLength);
         });
+    }
 
-        return frame_id;
+    //!
+    //! \brief Blocking on a response from the link's thread would keep that response from ever being processed
+    //!
+    void check_not_link_thread() const
+    {
+        if(m_Link->IsLinkThread())
+        {
+            throw std::runtime_error("Synchronous AT commands can not be issued from the radio's thread");
+        }
     }
 
+    void handle_frame(const std::vector<uint8_t> &frame);
+
     void handle_AT_command_response(const std::vector<uint8_t> &buff);
 
     void handle_transmit_status(const std::vector<uint8_t> &data);
@@ -287,18 +523,31 @@ private:
 
     void handle_receive_packet(const std::vector<uint8_t> &, const bool &explicitFrame = false);
 
+    void handle_route_information(const std::vector<uint8_t> &data);
+
     int reserve_next_frame_id();
 
     void find_and_invokve_frame(int frame_id, const std::vector<uint8_t> &data)
     {
-        if(this->m_CurrentFrames[frame_id].inUse == true && this->m_CurrentFrames[frame_id].framePersistance != NULL && this->m_CurrentFrames[frame_id].framePersistance->HasCallback() == true) {
-            this->m_CurrentFrames[frame_id].framePersistance->AddFrameReturn(frame_id, data);
+        if(m_FrameIds.IsInUse(frame_id) == false) {
+            return;
+        }
+
+        std::shared_ptr<FramePersistanceBehavior<>> framePersistance = std::atomic_load(&m_CurrentFrames[frame_id].framePersistance);
+        if(framePersistance != NULL && framePersistance->HasCallback() == true) {
+            framePersistance->AddFrameReturn(frame_id, data);
         }
     }
 
 
+    void release_frame(int frame_id);
+
     void finish_frame(int frame_id);
 
+    void expire_frame(int frame_id, uint32_t generation);
+
+    void tick_frame_expiry();
+
 
 };
 
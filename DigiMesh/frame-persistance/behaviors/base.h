@@ -3,6 +3,8 @@
 
 #include <functional>
 #include <memory>
+#include <atomic>
+#include <mutex>
 
 #include "../types/shutdown-first-response.h"
 
@@ -11,59 +13,147 @@ class FramePersistanceBehavior;
 
 
 template <>
-class FramePersistanceBehavior<>
+class FramePersistanceBehavior<> : public std::enable_shared_from_this<FramePersistanceBehavior<>>
 {
     std::shared_ptr<std::function<void()>> m_SendFramesUp;
     std::shared_ptr<std::function<void(const std::vector<uint8_t> &data)>> m_NewFrame;
     bool m_DoneBehaviorSet;
     std::function<void()> m_DoneBehavior;
+    std::function<void()> m_TimeoutBehavior;
+    std::atomic<bool> m_Finished;
+    // stays set once finished, so a frame expiring while another thread finishes it still goes through the behavior
+    std::atomic<bool> m_CallbackSet;
+    // a frame may finish on the scheduler's thread while responses arrive on the link's, guards the callbacks
+    mutable std::mutex m_CallbackMutex;
 
 public:
 
     FramePersistanceBehavior() :
         m_NewFrame(NULL),
         m_SendFramesUp(NULL),
-        m_DoneBehaviorSet(false)
+        m_DoneBehaviorSet(false),
+        m_Finished(false),
+        m_CallbackSet(false)
+    {
+    }
+
+    virtual ~FramePersistanceBehavior()
     {
     }
 
 
 
     bool HasCallback() const {
-        if(m_SendFramesUp == NULL) {
-            return false;
-        }
-        return true;
+        return m_CallbackSet;
     }
 
 
     void AddFrameReturn(int frame_id, const std::vector<uint8_t> &data) {
-        (*m_NewFrame)(data);
+        {
+            // stored under the lock, so a frame finishing on another thread never sends up a half stored response
+            std::lock_guard<std::mutex> lock(m_CallbackMutex);
+            if(m_Finished || m_NewFrame == NULL) {
+                return;
+            }
+            (*m_NewFrame)(data);
+        }
+
+        // outside the lock, receiving a frame may finish this one
+        FrameReceived();
     }
 
     void SendAndFinish() {
+        // a response and the frame's deadline can race, only the first one through finishes the frame
+        if(m_Finished.exchange(true))
+        {
+            return;
+        }
+        // taken locally, finishing may let the frame id be reused and this behavior be destroyed during the call
+        std::shared_ptr<std::function<void()>> sendFramesUp;
+        {
+            std::lock_guard<std::mutex> lock(m_CallbackMutex);
+            sendFramesUp.swap(m_SendFramesUp);
+            m_NewFrame = NULL;
+        }
         if(m_DoneBehaviorSet)
         {
             m_DoneBehavior();
         }
-        (*m_SendFramesUp)();
-        m_SendFramesUp = NULL;
-        m_NewFrame = NULL;
+        if(sendFramesUp != NULL) {
+            (*sendFramesUp)();
+        }
+    }
+
+    //!
+    //! \brief Finish the frame because its deadline passed without the expected response(s)
+    //!
+    //! Calls the timeout behavior if one is set, otherwise whatever has been collected so far is sent up.
+    //!
+    void TimeoutAndFinish() {
+        if(!m_TimeoutBehavior)
+        {
+            SendAndFinish();
+            return;
+        }
+
+        AbortAndFinish(m_TimeoutBehavior);
+    }
+
+    //!
+    //! \brief Finish the frame without waiting on further responses
+    //! \param func Function to run in place of sending up the collected frames
+    //! \return False if the frame had already finished, func is not called in that case
+    //!
+    bool AbortAndFinish(const std::function<void()> &func) {
+        if(m_Finished.exchange(true))
+        {
+            return false;
+        }
+
+        std::function<void()> abortBehavior = func;
+        {
+            std::lock_guard<std::mutex> lock(m_CallbackMutex);
+            m_SendFramesUp = NULL;
+            m_NewFrame = NULL;
+        }
+        if(m_DoneBehaviorSet)
+        {
+            m_DoneBehavior();
+        }
+        abortBehavior();
+        return true;
+    }
+
+    //!
+    //! \brief Called once the radio holds the frame, behaviors that time themselves start here
+    //!
+    virtual void Started() {
+    }
+
+    //!
+    //! \brief Minimum time the frame is expected to stay open waiting on responses
+    //!
+    virtual int LifetimeMS() const {
+        return 0;
     }
 
     template <typename T>
     void setCallback(const std::function<void(const std::vector<T> &)> &callback) {
         std::shared_ptr<std::vector<T>> vec = std::make_shared<std::vector<T>>();
 
-        m_NewFrame = std::make_shared<std::function<void(const std::vector<uint8_t> &data)>>([this, vec](const std::vector<uint8_t> &data)
+        std::shared_ptr<std::function<void(const std::vector<uint8_t> &data)>> newFrame = std::make_shared<std::function<void(const std::vector<uint8_t> &data)>>([vec](const std::vector<uint8_t> &data)
         {
             vec->push_back(T(data));
-            FrameReceived();
         });
 
-        m_SendFramesUp = std::make_shared<std::function<void()>>([callback, vec](){
+        std::shared_ptr<std::function<void()>> sendFramesUp = std::make_shared<std::function<void()>>([callback, vec](){
             callback(*vec);
         });
+
+        std::lock_guard<std::mutex> lock(m_CallbackMutex);
+        m_NewFrame = newFrame;
+        m_SendFramesUp = sendFramesUp;
+        m_CallbackSet = true;
     }
 
     void setFinishBehavior(const std::function<void()> &cb) {
@@ -71,6 +161,10 @@ public:
         m_DoneBehavior = cb;
     }
 
+    void setTimeoutBehavior(const std::function<void()> &cb) {
+        m_TimeoutBehavior = cb;
+    }
+
     virtual void FrameReceived() = 0;
 };
 
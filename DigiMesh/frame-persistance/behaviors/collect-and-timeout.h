@@ -13,22 +13,42 @@ class FramePersistanceBehavior<CollectAfterTimeout, Rest...> : public FramePersi
     static_assert(sizeof...(Rest) == 0, "Only one argument can be passed");
 
     Timer *m_Timer;
+    int m_NumMS;
 public:
 
-    FramePersistanceBehavior(const CollectAfterTimeout & params) {
-        m_Timer = new Timer(params.numMS, [this](){
-            FramePersistanceBehavior<Rest...>::SendAndFinish();
-        });
+    FramePersistanceBehavior(const CollectAfterTimeout & params) :
+        m_Timer(NULL),
+        m_NumMS(params.numMS)
+    {
     }
 
     ~FramePersistanceBehavior() {
         delete m_Timer;
     }
 
+    //!
+    //! \brief Start collecting, the timer only keeps a weak reference so the frame may be dropped while it fires
+    //!
+    virtual void Started()
+    {
+        std::weak_ptr<FramePersistanceBehavior<>> frame = this->shared_from_this();
+        m_Timer = new Timer(m_NumMS, [frame](){
+            std::shared_ptr<FramePersistanceBehavior<>> current = frame.lock();
+            if(current != NULL) {
+                current->SendAndFinish();
+            }
+        });
+    }
+
     virtual void FrameReceived()
     {
 
     }
+
+    virtual int LifetimeMS() const
+    {
+        return m_NumMS;
+    }
 };
 
 #endif // COLLECT_AND_TIMEOUT_H
@@ -0,0 +1,99 @@
+#ifndef FRAME_ENCODER_H
+#define FRAME_ENCODER_H
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "api_modes.h"
+#include "ring_buffer.h"
+
+#define START_BYTE 0x7e
+#define ESCAPE_BYTE 0x7d
+#define XON_BYTE 0x11
+#define XOFF_BYTE 0x13
+#define ESCAPE_XOR 0x20
+
+//!
+//! \brief Writes API frames straight into a transmit ring.
+//!
+//! A frame is given as a small fixed header (frame type onward) and a payload, neither is copied before being
+//! written. Length, checksum and, in escaped mode, escape sequences are produced while writing, so encoding does
+//! not touch the heap.
+//!
+class FrameEncoder
+{
+private:
+
+    APIModes m_Mode;
+
+public:
+
+    FrameEncoder(const APIModes &mode = APIModes::UNESCAPED) :
+        m_Mode(mode)
+    {
+    }
+
+    void SetMode(const APIModes &mode)
+    {
+        m_Mode = mode;
+    }
+
+    //!
+    //! \brief Upper bound on the number of bytes Encode will write
+    //! \param frameDataLength Length of header and payload together
+    //!
+    size_t MaxEncodedLength(size_t frameDataLength) const
+    {
+        if(m_Mode == APIModes::ESCAPED)
+        {
+            // every byte after the start byte may need escaping
+            return 1 + 2 * (frameDataLength + 3);
+        }
+        return frameDataLength + 4;
+    }
+
+    //!
+    //! \brief Encode a frame into the given ring
+    //!
+    //! The ring must have at least MaxEncodedLength(headerLength + payloadLength) bytes free.
+    //! \param out Ring to write to
+    //! \param header Bytes starting at the frame type
+    //! \param headerLength Number of header bytes
+    //! \param payload Bytes following the header
+    //! \param payloadLength Number of payload bytes
+    //!
+    void Encode(RingBuffer &out, const uint8_t *header, size_t headerLength, const uint8_t *payload, size_t payloadLength) const
+    {
+        size_t length = headerLength + payloadLength;
+        uint8_t sum = 0;
+
+        out.Put(START_BYTE);
+        put(out, (length >> 8) & 0xFF);
+        put(out, length & 0xFF);
+        for(size_t i = 0 ; i < headerLength ; i++)
+        {
+            sum += header[i];
+            put(out, header[i]);
+        }
+        for(size_t i = 0 ; i < payloadLength ; i++)
+        {
+            sum += payload[i];
+            put(out, payload[i]);
+        }
+        put(out, 0xFF - sum);
+    }
+
+private:
+
+    void put(RingBuffer &out, uint8_t byte) const
+    {
+        if(m_Mode == APIModes::ESCAPED && (byte == START_BYTE || byte == ESCAPE_BYTE || byte == XON_BYTE || byte == XOFF_BYTE))
+        {
+            out.Put(ESCAPE_BYTE);
+            byte ^= ESCAPE_XOR;
+        }
+        out.Put(byte);
+    }
+};
+
+#endif // FRAME_ENCODER_H
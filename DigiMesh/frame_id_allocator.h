@@ -0,0 +1,115 @@
+#ifndef FRAME_ID_ALLOCATOR_H
+#define FRAME_ID_ALLOCATOR_H
+
+#include <stdint.h>
+#include <atomic>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//!
+//! \brief Lock free allocator of the 255 usable API frame ids.
+//!
+//! Ids in use are tracked in a 256 bit atomic bitmap. A free id is found with a find-first-zero on a bitmap word and
+//! claimed with a compare-and-swap, so any number of threads may reserve and release concurrently.
+//!
+//! Searching starts after the most recently reserved id so ids cycle through the whole range, which keeps a late
+//! response from being matched to a frame that just reused its id. Frame id 0 tells the radio not to respond and is
+//! never handed out.
+//!
+class FrameIdAllocator
+{
+private:
+
+    static const unsigned NUM_WORDS = 4;
+
+    std::atomic<uint64_t> m_InUse[NUM_WORDS];
+    std::atomic<unsigned> m_Next;
+
+public:
+
+    FrameIdAllocator()
+    {
+        for(unsigned i = 0 ; i < NUM_WORDS ; i++)
+        {
+            m_InUse[i].store(0);
+        }
+        m_InUse[0].store(1);
+        m_Next.store(1);
+    }
+
+    //!
+    //! \brief Reserve a free frame id
+    //! \return Reserved id, -1 if all ids are in use
+    //!
+    int Reserve()
+    {
+        unsigned start = m_Next.load(std::memory_order_relaxed) & 0xFF;
+        unsigned startWord = start >> 6;
+        unsigned startBit = start & 63;
+
+        // the starting word is visited twice, first from the starting bit up and last for the bits below it
+        for(unsigned n = 0 ; n <= NUM_WORDS ; n++)
+        {
+            unsigned word = (startWord + n) % NUM_WORDS;
+            uint64_t mask = ~0ull;
+            if(n == 0)
+            {
+                mask = ~0ull << startBit;
+            }
+            else if(n == NUM_WORDS)
+            {
+                mask = ~(~0ull << startBit);
+            }
+
+            uint64_t current = m_InUse[word].load(std::memory_order_relaxed);
+            uint64_t free;
+            while((free = ~current & mask) != 0)
+            {
+                uint64_t bit = free & (~free + 1);
+                if(m_InUse[word].compare_exchange_weak(current, current | bit, std::memory_order_acq_rel, std::memory_order_relaxed))
+                {
+                    int id = word * 64 + count_trailing_zeros(bit);
+                    m_Next.store(id + 1, std::memory_order_relaxed);
+                    return id;
+                }
+            }
+        }
+
+        return -1;
+    }
+
+    //!
+    //! \brief Return a frame id to the pool
+    //! \param id Id previously returned by Reserve
+    //!
+    void Release(int id)
+    {
+        if(id <= 0 || id > 255)
+        {
+            return;
+        }
+        m_InUse[id >> 6].fetch_and(~(1ull << (id & 63)), std::memory_order_release);
+    }
+
+    bool IsInUse(int id) const
+    {
+        return (m_InUse[(id >> 6) & 3].load(std::memory_order_acquire) >> (id & 63)) & 1;
+    }
+
+private:
+
+    static unsigned count_trailing_zeros(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+};
+
+#endif // FRAME_ID_ALLOCATOR_H
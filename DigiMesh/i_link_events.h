@@ -2,6 +2,7 @@
 #define I_LINK_EVENTS_H
 
 #include <cstdlib>
+#include <stdint.h>
 #include <vector>
 #include <string>
 
@@ -11,7 +12,16 @@ class ILinkEvents
 {
 public:
 
-    virtual void ReceiveData(SerialLink *link_ptr, const std::vector<uint8_t> &buffer) = 0;
+    //!
+    //! \brief Called on the link's thread when bytes have been read from the port
+    //!
+    //! The bytes are a view into the link's receive ring and are only valid for the duration of the call, listeners
+    //! must consume or copy what they need before returning.
+    //! \param link_ptr Link the bytes arrived on
+    //! \param buffer Pointer to the received bytes
+    //! \param length Number of bytes received
+    //!
+    virtual void ReceiveData(SerialLink *link_ptr, const uint8_t *buffer, size_t length) = 0;
 
     virtual void CommunicationError(const SerialLink* link_ptr, const std::string &type, const std::string &msg) = 0;
 
@@ -0,0 +1,171 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <cstddef>
+#include <chrono>
+#include <algorithm>
+
+#include "transmit_status_types.h"
+
+// fraction of the ceiling added to the rate per successful transmit status
+#define RATE_INCREASE_STEP 0.02
+// factor the rate is multiplied by per congestion failure
+#define RATE_DECREASE_FACTOR 0.75
+// lowest rate as a fraction of the ceiling
+#define RATE_FLOOR_FRACTION 0.125
+
+//!
+//! \brief Token bucket pacing the bytes handed to the radio, adapting its rate to how the radio fares.
+//!
+//! Tokens accrue at the current rate up to the bucket's capacity. The capacity covers the bytes sent during one
+//! smoothed transmit status turnaround, so the radio is kept busy while statuses are outstanding without more being
+//! queued inside it than it can send. A frame larger than the capacity is let through once the bucket is full and
+//! leaves it in debt.
+//!
+//! The rate climbs additively with every successful transmit status and is cut multiplicatively on failures that
+//! indicate congestion, staying between a floor and the ceiling.
+//!
+//! The limiter performs no locking, the owner is responsible for synchronizing access.
+//!
+class RateLimiter
+{
+private:
+
+    double m_Ceiling;
+    double m_Floor;
+    double m_Rate;
+
+    double m_Tokens;
+    double m_MinCapacity;
+    std::chrono::steady_clock::time_point m_LastRefill;
+
+    double m_SmoothedTurnaround;
+
+public:
+
+    //!
+    //! \param bytesPerSecond Ceiling of the rate
+    //! \param minCapacity Smallest bucket capacity in bytes
+    //!
+    RateLimiter(double bytesPerSecond, double minCapacity) :
+        m_Tokens(minCapacity),
+        m_MinCapacity(minCapacity),
+        m_LastRefill(std::chrono::steady_clock::now()),
+        m_SmoothedTurnaround(0)
+    {
+        SetCeiling(bytesPerSecond);
+    }
+
+    //!
+    //! \brief Set the highest rate, the current rate is reset to it
+    //! \param bytesPerSecond Ceiling of the rate, 0 lets everything through
+    //!
+    void SetCeiling(double bytesPerSecond)
+    {
+        m_Ceiling = bytesPerSecond;
+        m_Floor = bytesPerSecond * RATE_FLOOR_FRACTION;
+        m_Rate = bytesPerSecond;
+    }
+
+    bool Enabled() const
+    {
+        return m_Ceiling > 0;
+    }
+
+    double Rate() const
+    {
+        return m_Rate;
+    }
+
+    double Capacity() const
+    {
+        return std::max(m_MinCapacity, m_Rate * m_SmoothedTurnaround);
+    }
+
+    //!
+    //! \brief Take tokens for a frame if enough have accrued
+    //! \param bytes Size of the frame
+    //! \param now Current time
+    //! \return False if the frame has to wait, see TimeUntil
+    //!
+    bool TryConsume(size_t bytes, const std::chrono::steady_clock::time_point &now)
+    {
+        if(!Enabled()) {
+            return true;
+        }
+
+        refill(now);
+        if(m_Tokens < std::min((double)bytes, Capacity())) {
+            return false;
+        }
+        m_Tokens -= bytes;
+        return true;
+    }
+
+    //!
+    //! \brief Return tokens taken for a frame that could not be sent after all
+    //!
+    void Refund(size_t bytes)
+    {
+        if(Enabled()) {
+            m_Tokens = std::min(Capacity(), m_Tokens + bytes);
+        }
+    }
+
+    //!
+    //! \brief Time until a frame refused by TryConsume could be sent
+    //!
+    std::chrono::microseconds TimeUntil(size_t bytes, const std::chrono::steady_clock::time_point &now)
+    {
+        refill(now);
+        double missing = std::min((double)bytes, Capacity()) - m_Tokens;
+        if(missing <= 0 || m_Rate <= 0) {
+            return std::chrono::microseconds(0);
+        }
+        return std::chrono::microseconds((long long)(missing / m_Rate * 1e6) + 1);
+    }
+
+    //!
+    //! \brief Adapt to a transmit status reported by the radio
+    //! \param status Status of the frame
+    //! \param turnaround Time from handing the frame to the link until its status arrived
+    //!
+    void OnStatus(TransmitStatusTypes status, const std::chrono::steady_clock::duration &turnaround)
+    {
+        if(!Enabled()) {
+            return;
+        }
+
+        switch(status)
+        {
+        case TransmitStatusTypes::SUCCESS:
+        {
+            double sample = std::chrono::duration<double>(turnaround).count();
+            m_SmoothedTurnaround = m_SmoothedTurnaround == 0 ? sample : m_SmoothedTurnaround + (sample - m_SmoothedTurnaround) / 8;
+            m_Rate = std::min(m_Ceiling, m_Rate + m_Ceiling * RATE_INCREASE_STEP);
+            break;
+        }
+        case TransmitStatusTypes::MAC_ACK_FAILURE:
+        case TransmitStatusTypes::COLLISION_AVOIDANCE_FAILURE:
+        case TransmitStatusTypes::NETWORK_ACK_FAILURE:
+        case TransmitStatusTypes::INTERNAL_RESOURCE_ERROR:
+        case TransmitStatusTypes::TIMEOUT:
+            m_Rate = std::max(m_Floor, m_Rate * RATE_DECREASE_FACTOR);
+            break;
+        default:
+            // not a sign of congestion
+            break;
+        }
+    }
+
+private:
+
+    void refill(const std::chrono::steady_clock::time_point &now)
+    {
+        double elapsed = std::chrono::duration<double>(now - m_LastRefill).count();
+        m_LastRefill = now;
+        m_Tokens = std::min(Capacity(), m_Tokens + elapsed * m_Rate);
+    }
+};
+
+#endif // RATE_LIMITER_H
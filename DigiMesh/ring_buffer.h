@@ -0,0 +1,144 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+
+//!
+//! \brief Fixed size byte ring that is allocated once and then filled and drained in place.
+//!
+//! Head and tail are free running counters, so the capacity must be a power of two. Readers and writers work on
+//! contiguous regions of the underlying storage, there are at most two such regions when the data wraps around.
+//!
+//! The ring performs no locking, the owner is responsible for synchronizing access.
+//!
+class RingBuffer
+{
+private:
+
+    std::vector<uint8_t> m_Buffer;
+    size_t m_Mask;
+    size_t m_Head;
+    size_t m_Tail;
+
+public:
+
+    RingBuffer(size_t capacity) :
+        m_Buffer(capacity),
+        m_Mask(capacity - 1),
+        m_Head(0),
+        m_Tail(0)
+    {
+        if(capacity == 0 || (capacity & (capacity - 1)) != 0)
+        {
+            throw std::runtime_error("Ring buffer capacity must be a power of two");
+        }
+    }
+
+    size_t Capacity() const
+    {
+        return m_Buffer.size();
+    }
+
+    //!
+    //! \brief Number of bytes waiting to be read
+    //!
+    size_t Size() const
+    {
+        return m_Head - m_Tail;
+    }
+
+    //!
+    //! \brief Number of bytes that can still be written
+    //!
+    size_t Free() const
+    {
+        return Capacity() - Size();
+    }
+
+    //!
+    //! \brief Get the largest contiguous region that can be written to
+    //! \param[out] length Number of bytes that can be written at the returned pointer
+    //! \return Pointer into the ring to write to
+    //!
+    uint8_t* WriteRegion(size_t &length)
+    {
+        size_t start = m_Head & m_Mask;
+        size_t toEnd = Capacity() - start;
+        length = Free() < toEnd ? Free() : toEnd;
+        return m_Buffer.data() + start;
+    }
+
+    //!
+    //! \brief Mark bytes written through WriteRegion as readable
+    //! \param length Number of bytes written
+    //!
+    void Commit(size_t length)
+    {
+        m_Head += length;
+    }
+
+    //!
+    //! \brief Get the largest contiguous region that can be read from
+    //! \param[out] length Number of bytes readable at the returned pointer
+    //! \return Pointer into the ring to read from
+    //!
+    const uint8_t* ReadRegion(size_t &length) const
+    {
+        size_t start = m_Tail & m_Mask;
+        size_t toEnd = Capacity() - start;
+        length = Size() < toEnd ? Size() : toEnd;
+        return m_Buffer.data() + start;
+    }
+
+    //!
+    //! \brief Release bytes that have been read through ReadRegion
+    //! \param length Number of bytes read
+    //!
+    void Consume(size_t length)
+    {
+        m_Tail += length;
+    }
+
+    //!
+    //! \brief Copy bytes into the ring
+    //! \return False if there isn't enough room, in which case nothing is written
+    //!
+    bool Push(const uint8_t *data, size_t length)
+    {
+        if(length > Free())
+        {
+            return false;
+        }
+
+        while(length > 0)
+        {
+            size_t regionLength;
+            uint8_t *region = WriteRegion(regionLength);
+            size_t count = length < regionLength ? length : regionLength;
+            std::memcpy(region, data, count);
+            Commit(count);
+            data += count;
+            length -= count;
+        }
+        return true;
+    }
+
+    //!
+    //! \brief Append a single byte, the caller must have checked there is room
+    //!
+    void Put(uint8_t byte)
+    {
+        m_Buffer[m_Head & m_Mask] = byte;
+        m_Head++;
+    }
+
+    void Clear()
+    {
+        m_Tail = m_Head;
+    }
+};
+
+#endif // RING_BUFFER_H
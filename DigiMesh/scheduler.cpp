@@ -0,0 +1,149 @@
+#include "scheduler.h"
+
+#include <iostream>
+
+
+Scheduler& Scheduler::Instance()
+{
+    static Scheduler instance;
+    return instance;
+}
+
+
+Scheduler::Scheduler() :
+    m_NextID(1),
+    m_Running(0),
+    m_Stop(false)
+{
+    m_Thread = std::thread([this](){
+        run();
+    });
+}
+
+
+Scheduler::~Scheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_Condition.notify_one();
+    m_Thread.join();
+}
+
+
+Scheduler::TaskID Scheduler::Schedule(int delayMS, const std::function<void()> &func)
+{
+    return add_task(delayMS, 0, func);
+}
+
+
+Scheduler::TaskID Scheduler::SchedulePeriodic(int periodMS, const std::function<void()> &func)
+{
+    return add_task(periodMS, periodMS, func);
+}
+
+
+bool Scheduler::Cancel(TaskID id, bool waitForRunning)
+{
+    // ids start at 1, 0 is what holders of no task keep and would match an idle scheduler's m_Running
+    if(id == 0) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    bool pending = m_Tasks.erase(id) > 0;
+
+    if(waitForRunning && std::this_thread::get_id() != m_Thread.get_id())
+    {
+        m_RunningDone.wait(lock, [this, id](){
+            return m_Running != id;
+        });
+    }
+
+    return pending;
+}
+
+
+bool Scheduler::IsSchedulerThread() const
+{
+    return std::this_thread::get_id() == m_Thread.get_id();
+}
+
+
+Scheduler::TaskID Scheduler::add_task(int delayMS, int periodMS, const std::function<void()> &func)
+{
+    Task task;
+    task.func = std::make_shared<std::function<void()>>(func);
+    task.period = std::chrono::milliseconds(periodMS);
+
+    Entry entry;
+    entry.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(delayMS);
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        entry.id = m_NextID++;
+        m_Tasks.insert({entry.id, task});
+        m_Queue.push(entry);
+    }
+    m_Condition.notify_one();
+
+    return entry.id;
+}
+
+
+void Scheduler::run()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while(m_Stop == false)
+    {
+        if(m_Queue.empty())
+        {
+            m_Condition.wait(lock);
+            continue;
+        }
+
+        Entry entry = m_Queue.top();
+        if(entry.deadline > std::chrono::steady_clock::now())
+        {
+            m_Condition.wait_until(lock, entry.deadline);
+            continue;
+        }
+        m_Queue.pop();
+
+        auto it = m_Tasks.find(entry.id);
+        if(it == m_Tasks.end())
+        {
+            //cancelled
+            continue;
+        }
+
+        std::shared_ptr<std::function<void()>> func = it->second.func;
+        std::chrono::milliseconds period = it->second.period;
+        if(period.count() == 0)
+        {
+            m_Tasks.erase(it);
+        }
+
+        m_Running = entry.id;
+        lock.unlock();
+        try
+        {
+            (*func)();
+        }
+        catch(const std::exception &e)
+        {
+            std::cout << "Exception in scheduled task: " << e.what() << std::endl;
+        }
+        lock.lock();
+        m_Running = 0;
+        m_RunningDone.notify_all();
+
+        // periodic tasks go back on the heap unless cancelled while running
+        if(period.count() != 0 && m_Tasks.find(entry.id) != m_Tasks.end())
+        {
+            entry.deadline += period;
+            m_Queue.push(entry);
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "DigiMesh_global.h"
+
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+//!
+//! \brief Process wide scheduler running delayed and periodic tasks on a single thread.
+//!
+//! Pending tasks are kept in a min-heap ordered by deadline, the thread sleeps until the earliest one is due.
+//! Cancelled tasks are dropped from the heap lazily when they reach the top.
+//!
+//! Tasks run one at a time on the scheduler's thread and should be short, anything lengthy should be handed off.
+//!
+class DIGIMESHSHARED_EXPORT Scheduler
+{
+public:
+
+    typedef uint64_t TaskID;
+
+private:
+
+    struct Task
+    {
+        std::shared_ptr<std::function<void()>> func;
+        std::chrono::milliseconds period;
+    };
+
+    struct Entry
+    {
+        std::chrono::steady_clock::time_point deadline;
+        TaskID id;
+
+        bool operator>(const Entry &rhs) const
+        {
+            return deadline > rhs.deadline;
+        }
+    };
+
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_Queue;
+    std::unordered_map<TaskID, Task> m_Tasks;
+    TaskID m_NextID;
+    TaskID m_Running;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::condition_variable m_RunningDone;
+    std::thread m_Thread;
+    bool m_Stop;
+
+public:
+
+    //!
+    //! \brief Get the scheduler shared by everything in this process
+    //!
+    static Scheduler& Instance();
+
+    ~Scheduler();
+
+    //!
+    //! \brief Run a function once after a delay
+    //! \param delayMS Delay in milliseconds
+    //! \param func Function to run on the scheduler's thread
+    //! \return Id that can be passed to Cancel
+    //!
+    TaskID Schedule(int delayMS, const std::function<void()> &func);
+
+    //!
+    //! \brief Run a function repeatedly until cancelled
+    //! \param periodMS Time between runs in milliseconds, the first run is one period from now
+    //! \param func Function to run on the scheduler's thread
+    //! \return Id that can be passed to Cancel
+    //!
+    TaskID SchedulePeriodic(int periodMS, const std::function<void()> &func);
+
+    //!
+    //! \brief Cancel a task
+    //!
+    //! If the task is running on the scheduler's thread at the time, this waits for it to return, unless called from
+    //! the task itself or told not to. Once Cancel returns the task will not start again.
+    //!
+    //! Destructors of objects a task may hold the last reference to should not wait, the task would be waiting on
+    //! itself through whatever lock its owner holds.
+    //! \param id Task to cancel, 0 is ignored
+    //! \param waitForRunning [true] Wait for a run in progress to return
+    //! \return True if the task was still pending
+    //!
+    bool Cancel(TaskID id, bool waitForRunning = true);
+
+    //!
+    //! \brief Check whether the calling thread is the scheduler's, blocking there would stall every other task
+    //!
+    bool IsSchedulerThread() const;
+
+private:
+
+    Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    TaskID add_task(int delayMS, int periodMS, const std::function<void()> &func);
+
+    void run();
+};
+
+#endif // SCHEDULER_H
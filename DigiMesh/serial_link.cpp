@@ -2,18 +2,21 @@
 
 #include <iostream>
 #include <functional>
+#include <algorithm>
 
 #include <QCoreApplication>
-#include <QTimer>
 
 
 //!
 //! \brief This class defines a thread such that a QObject can run in peace.
 //!
+//! The thread only runs a Qt event loop, objects moved onto it (such as the serial port) are driven by their own
+//! signals rather than by polling.
+//!
 class AppThread : public QThread
 {
 public:
-    AppThread(const size_t interval, std::function<void()> func)
+    AppThread()
     {
         if(QCoreApplication::instance() == NULL)
         {
@@ -21,34 +24,28 @@ public:
             char * argv[] = {(char *)"sharedlib.app"};
             pApp = new QCoreApplication(argc, argv);
         }
-
-        m_Interval = interval;
-        m_Func = func;
     }
 
     virtual void run()
     {
-        QTimer *timer = new QTimer(0);
-        timer->moveToThread(this);
-        pApp->connect(timer, &QTimer::timeout, m_Func);
-        timer->start(m_Interval);
-
         exec();
     }
 
 private:
 
     QCoreApplication *pApp;
-
-    std::function<void()> m_Func;
-    size_t m_Interval;
 };
 
 SerialLink::SerialLink(const SerialConfiguration &config) :
+    m_ReceiveBuffer(RECEIVE_BUFFER_SIZE),
+    m_TransmitBuffer(TRANSMIT_BUFFER_SIZE),
+    m_FlushPending(false),
+    m_BacklogLimit(TRANSMIT_BUFFER_SIZE),
     _config(config)
 {
     m_bytesRead = 0;
     m_port     = NULL;
+    m_ListenThread = NULL;
     m_stopp    = false;
     m_reqReset = false;
 
@@ -93,6 +90,36 @@ void SerialLink::WriteBytes(const char *bytes, int length)
     }
 }
 
+void SerialLink::FlushTransmitBuffer(void)
+{
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    m_FlushPending = false;
+
+    if(!m_port || !m_port->isOpen()) {
+        m_TransmitBuffer.Clear();
+        return;
+    }
+
+    // Only a chunk is handed to the port at a time, the rest stays in the ring where the backlog limit applies. The
+    // port's bytesWritten signal flushes the next chunk.
+    qint64 queued = m_port->bytesToWrite();
+    while (queued < PORT_WRITE_CHUNK) {
+        size_t length;
+        const uint8_t *region = m_TransmitBuffer.ReadRegion(length);
+        if (length == 0) {
+            break;
+        }
+        length = std::min<size_t>(length, PORT_WRITE_CHUNK - queued);
+        m_port->write(reinterpret_cast<const char*>(region), length);
+        m_TransmitBuffer.Consume(length);
+        queued += length;
+    }
+
+    if (m_TransmitBuffer.Size() > 0) {
+        m_FlushPending = true;
+    }
+}
+
 //!
 //! \brief Determine the connection status
 //! \return True if the connection is established, false otherwise
@@ -139,11 +166,24 @@ bool SerialLink::Connect(void)
 
 void SerialLink::Disconnect(void)
 {
+    // stop dispatching port signals before the port is torn down
+    if (m_ListenThread) {
+        m_ListenThread->quit();
+        m_ListenThread->wait();
+        delete m_ListenThread;
+        m_ListenThread = NULL;
+    }
+
     if (m_port) {
         m_port->close();
         delete m_port;
         m_port = NULL;
     }
+
+    // a flush continued by the old port's bytesWritten will never run
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    m_TransmitBuffer.Clear();
+    m_FlushPending = false;
 }
 
 
@@ -186,17 +226,7 @@ bool SerialLink::_hardwareConnect(QSerialPort::SerialPortError& error, QString&
 
     m_port = new QSerialPort(QString::fromStdString(_config.portName()).trimmed());
 
-    m_ListenThread = new AppThread(10, [&](){
-        try
-        {
-            this->PortEventLoop();
-        }
-        catch(std::runtime_error e) {
-            printf("Error: %s\n", e.what());
-            throw e;
-        }
-
-    });
+    m_ListenThread = new AppThread();
 
 
 
@@ -226,6 +256,18 @@ bool SerialLink::_hardwareConnect(QSerialPort::SerialPortError& error, QString&
 
     m_port->moveToThread(m_ListenThread);
 
+    // Service the port as soon as the driver reports data, the port is the context object so the slots run on the
+    // listen thread alongside it.
+    QObject::connect(m_port, &QSerialPort::readyRead, m_port, [this](){
+        this->PortReadyRead();
+    });
+    QObject::connect(m_port, &QSerialPort::bytesWritten, m_port, [this](qint64){
+        this->FlushTransmitBuffer();
+    });
+    QObject::connect(m_port, &QSerialPort::errorOccurred, m_port, [this](QSerialPort::SerialPortError error){
+        this->linkError(error);
+    });
+
     std::cout << "Configuring port" << std::endl;
 
     m_port->setBaudRate     ((int)_config.baud());
@@ -283,15 +325,33 @@ bool SerialLink::_isBootloader()
 
 void SerialLink::_readBytes(void)
 {
-    qint64 byteCount = m_port->bytesAvailable();
-    if (byteCount) {
-        QByteArray buffer;
-        buffer.resize(byteCount);
-        m_port->read(buffer.data(), buffer.size());
+    while (m_port->bytesAvailable() > 0) {
+        size_t length;
+        uint8_t *region = m_ReceiveBuffer.WriteRegion(length);
+
+        qint64 byteCount = m_port->read(reinterpret_cast<char*>(region), length);
+        if (byteCount <= 0) {
+            break;
+        }
+        m_ReceiveBuffer.Commit(byteCount);
+        m_bytesRead += byteCount;
 
-        std::vector<uint8_t> vec_buffer = std::vector<uint8_t>(buffer.begin(), buffer.end());
+        _dispatchReceivedBytes();
+    }
+}
 
-        EmitEvent([this,&vec_buffer](ILinkEvents *ptr){ptr->ReceiveData(this, vec_buffer);});
+void SerialLink::_dispatchReceivedBytes(void)
+{
+    // listeners are walked directly, wrapping the call in a std::function would allocate on every read
+    size_t length;
+    const uint8_t *region = m_ReceiveBuffer.ReadRegion(length);
+    while (length > 0) {
+        for(ILinkEvents* listener : m_Listeners)
+        {
+            listener->ReceiveData(this, region, length);
+        }
+        m_ReceiveBuffer.Consume(length);
+        region = m_ReceiveBuffer.ReadRegion(length);
     }
 }
 
@@ -314,26 +374,18 @@ void SerialLink::linkError(QSerialPort::SerialPortError error)
 }
 
 
-void SerialLink::PortEventLoop()
+void SerialLink::PortReadyRead()
 {
     try
     {
-        if(m_port->bytesAvailable())
-            this->_readBytes();
-
-
-
-        if(m_port->errorString() != "")
-        {
-            linkError(m_port->error());
-        }
+        this->_readBytes();
     }
     catch(const std::exception &e)
     {
         std::cout << "Exception in Qt Event Loop!" << std::endl;
         std::cout << "Type:    " << typeid(e).name()  << std::endl;
         std::cout << "Message: " << e.what() << std::endl;
-        throw e;
+        throw;
     }
 }
 
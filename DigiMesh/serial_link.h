@@ -17,6 +17,11 @@
 #include "serial_configuration.h"
 
 #include "i_link_events.h"
+#include "ring_buffer.h"
+
+#define RECEIVE_BUFFER_SIZE 4096
+#define TRANSMIT_BUFFER_SIZE 8192
+#define PORT_WRITE_CHUNK 64
 
 class DIGIMESHSHARED_EXPORT SerialLink
 {
@@ -47,6 +52,58 @@ public:
 
     virtual void WriteBytes(const char *bytes, int length);
 
+    //!
+    //! \brief Encode a frame straight into the transmit ring and have it written out on the link's thread
+    //!
+    //! Safe to call from any thread. Only the first frame written into an empty ring wakes the link's thread, frames
+    //! written while a flush is pending go out with it.
+    //!
+    //! A frame is refused if it would take the bytes waiting in the ring past the backlog limit, unless the ring is
+    //! empty so any frame can eventually be sent.
+    //! \param maxLength Upper bound of the number of bytes encode will write
+    //! \param encode Callable given the RingBuffer to write the frame into
+    //! \return False if the transmit ring has no room for maxLength bytes, nothing is written in that case
+    //!
+    template <typename F>
+    bool WriteFrame(size_t maxLength, const F &encode)
+    {
+        if(!isConnected()) {
+            _emitLinkError("Could not send data - link " + getPortName() + " is disconnected!");
+            return true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_writeMutex);
+            if(m_TransmitBuffer.Free() < maxLength || (m_TransmitBuffer.Size() > 0 && m_TransmitBuffer.Size() + maxLength > m_BacklogLimit)) {
+                return false;
+            }
+            encode(m_TransmitBuffer);
+
+            if(m_FlushPending) {
+                return true;
+            }
+            m_FlushPending = true;
+        }
+
+        MarshalOnThread([this](){
+            this->FlushTransmitBuffer();
+        });
+        return true;
+    }
+
+    //!
+    //! \brief Limit how many bytes may wait in the transmit ring
+    //!
+    //! Bytes in the ring go out in the order they were written, a sender that orders its traffic keeps the limit to a
+    //! short stretch of airtime so little waits where it can't be reordered.
+    //! \param bytes Limit, at most TRANSMIT_BUFFER_SIZE
+    //!
+    void SetTransmitBacklogLimit(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        m_BacklogLimit = bytes;
+    }
+
     //!
     //! \brief Determine the connection status
     //! \return True if the connection is established, false otherwise
@@ -62,6 +119,14 @@ public:
 
     virtual void Disconnect(void);
 
+    //!
+    //! \brief Determine if the calling thread is the one the link receives data on
+    //!
+    bool IsLinkThread() const
+    {
+        return m_ListenThread != NULL && QThread::currentThread() == m_ListenThread;
+    }
+
     virtual void MarshalOnThread(std::function<void()> func){
         ///////////////////
         /// Determine what thread to run function on
@@ -109,11 +174,18 @@ private:
 
     void _readBytes(void);
 
+    void _dispatchReceivedBytes(void);
+
+    void FlushTransmitBuffer(void);
+
     void linkError(QSerialPort::SerialPortError error);
 
 private:
 
-    void PortEventLoop();
+    //!
+    //! \brief Invoked on the listen thread whenever the port signals readyRead
+    //!
+    void PortReadyRead();
 
 
 private:
@@ -122,8 +194,12 @@ private:
     quint64 m_bytesRead;
     int     m_timeout;
     QThread *m_ListenThread;
+    RingBuffer m_ReceiveBuffer;    // Filled directly by the port and handed to listeners in place
     std::mutex  m_dataMutex;       // Mutex for reading data from _port
-    std::mutex  m_writeMutex;      // Mutex for accessing the _transmitBuffer.
+    std::mutex  m_writeMutex;      // Mutex for accessing the m_TransmitBuffer.
+    RingBuffer  m_TransmitBuffer;  // Frames encoded by any thread, written to the port on the listen thread
+    bool        m_FlushPending;    // A flush of m_TransmitBuffer has been posted, or the port's bytesWritten will continue it
+    size_t      m_BacklogLimit;    // Bytes allowed to wait in m_TransmitBuffer
 
 
     volatile bool        m_stopp;
@@ -2,23 +2,30 @@
 #define TIMER_H
 
 #include <functional>
-#include <chrono>
-#include <thread>
 
+#include "scheduler.h"
+
+//!
+//! \brief One shot timer run by the shared Scheduler.
+//!
+//! Destroying the timer cancels it without waiting on a run in progress, so the function must not rely on its owner
+//! being alive. Have it hold a weak_ptr to the owner rather than a raw pointer.
+//!
 class Timer
 {
 private:
-    std::function<void()> m_Func;
-    std::thread m_Thread;
+    Scheduler::TaskID m_Task;
 public:
     Timer(int timeoutInMS, const std::function<void()> func) {
-        m_Func = func;
+        m_Task = Scheduler::Instance().Schedule(timeoutInMS, func);
+    }
 
-        m_Thread = std::thread([timeoutInMS, func]() {
-           std::this_thread::sleep_for(std::chrono::milliseconds(timeoutInMS));
-           func();
-        });
+    ~Timer() {
+        Scheduler::Instance().Cancel(m_Task, false);
     }
+
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
 };
 
 #endif // TIMER_H
@@ -0,0 +1,176 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <vector>
+#include <chrono>
+#include <cstddef>
+
+//!
+//! \brief Hashed timing wheel tracking deadlines of a fixed range of integer ids.
+//!
+//! Each id sits in the slot its deadline falls into, slots are intrusive doubly linked lists indexed by id so
+//! scheduling, cancelling and expiring never allocate. Deadlines further out than one revolution stay in their slot
+//! until the revolution in which they actually expire.
+//!
+//! The wheel performs no locking, the owner is responsible for synchronizing access.
+//!
+class TimingWheel
+{
+private:
+
+    enum { NONE = -1 };
+
+    std::chrono::milliseconds m_Resolution;
+    std::vector<int> m_SlotHeads;
+    std::vector<int> m_Next;
+    std::vector<int> m_Prev;
+    std::vector<int> m_Slot;
+    std::vector<std::chrono::steady_clock::time_point> m_Deadlines;
+
+    size_t m_CurrentSlot;
+    std::chrono::steady_clock::time_point m_Tick;
+    size_t m_Count;
+
+public:
+
+    //!
+    //! \param numIds Ids 0 to numIds-1 can be scheduled
+    //! \param numSlots Number of slots in one revolution of the wheel
+    //! \param resolution Time covered by each slot
+    //!
+    TimingWheel(size_t numIds, size_t numSlots, const std::chrono::milliseconds &resolution) :
+        m_Resolution(resolution),
+        m_SlotHeads(numSlots, NONE),
+        m_Next(numIds, NONE),
+        m_Prev(numIds, NONE),
+        m_Slot(numIds, NONE),
+        m_Deadlines(numIds),
+        m_CurrentSlot(0),
+        m_Tick(std::chrono::steady_clock::now()),
+        m_Count(0)
+    {
+    }
+
+    std::chrono::milliseconds Resolution() const
+    {
+        return m_Resolution;
+    }
+
+    bool Empty() const
+    {
+        return m_Count == 0;
+    }
+
+    bool IsScheduled(int id) const
+    {
+        return m_Slot[id] != NONE;
+    }
+
+    //!
+    //! \brief Set the deadline of an id, replacing any deadline it already has
+    //! \param id Id to schedule
+    //! \param timeout Time from now at which the id expires
+    //!
+    void Schedule(int id, const std::chrono::milliseconds &timeout)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        Cancel(id);
+
+        // nothing was pending, so the wheel may not have been advanced in a while
+        if(m_Count == 0)
+        {
+            m_Tick = now;
+        }
+
+        m_Deadlines[id] = now + timeout;
+
+        std::chrono::steady_clock::duration untilDeadline = m_Deadlines[id] - m_Tick;
+        size_t ticks = (untilDeadline + m_Resolution - std::chrono::steady_clock::duration(1)) / m_Resolution;
+        if(ticks == 0)
+        {
+            ticks = 1;
+        }
+        size_t slot = (m_CurrentSlot + ticks) % m_SlotHeads.size();
+
+        m_Slot[id] = slot;
+        m_Prev[id] = NONE;
+        m_Next[id] = m_SlotHeads[slot];
+        if(m_SlotHeads[slot] != NONE)
+        {
+            m_Prev[m_SlotHeads[slot]] = id;
+        }
+        m_SlotHeads[slot] = id;
+        m_Count++;
+    }
+
+    //!
+    //! \brief Remove the deadline of an id, does nothing if the id isn't scheduled
+    //!
+    void Cancel(int id)
+    {
+        if(m_Slot[id] == NONE)
+        {
+            return;
+        }
+
+        if(m_Prev[id] != NONE)
+        {
+            m_Next[m_Prev[id]] = m_Next[id];
+        }
+        else
+        {
+            m_SlotHeads[m_Slot[id]] = m_Next[id];
+        }
+        if(m_Next[id] != NONE)
+        {
+            m_Prev[m_Next[id]] = m_Prev[id];
+        }
+
+        m_Slot[id] = NONE;
+        m_Next[id] = NONE;
+        m_Prev[id] = NONE;
+        m_Count--;
+    }
+
+    //!
+    //! \brief Turn the wheel up to the given time, removing every id whose deadline has passed
+    //! \param now Current time
+    //! \param expired Ids that expired are appended here
+    //!
+    void Advance(const std::chrono::steady_clock::time_point &now, std::vector<int> &expired)
+    {
+        size_t visited = 0;
+        while(m_Tick + m_Resolution <= now)
+        {
+            m_Tick += m_Resolution;
+            m_CurrentSlot = (m_CurrentSlot + 1) % m_SlotHeads.size();
+
+            // once every slot has been visited the remaining ticks can't expire anything new
+            if(visited < m_SlotHeads.size())
+            {
+                expire_slot(m_CurrentSlot, now, expired);
+                visited++;
+            }
+        }
+    }
+
+private:
+
+    void expire_slot(size_t slot, const std::chrono::steady_clock::time_point &now, std::vector<int> &expired)
+    {
+        int id = m_SlotHeads[slot];
+        while(id != NONE)
+        {
+            int next = m_Next[id];
+            if(m_Deadlines[id] <= now)
+            {
+                Cancel(id);
+                expired.push_back(id);
+            }
+            id = next;
+        }
+    }
+};
+
+#endif // TIMING_WHEEL_H
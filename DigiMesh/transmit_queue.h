@@ -0,0 +1,356 @@
+#ifndef TRANSMIT_QUEUE_H
+#define TRANSMIT_QUEUE_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <functional>
+
+#include "ATData/transmit_status.h"
+#include "transmit_priority.h"
+#include "transmit_options.h"
+
+//!
+//! \brief What to do with a message when its class's queue is already at its depth
+//!
+enum class TransmitQueuePolicy
+{
+    //! Wait for room until the queue's block timeout passes
+    BLOCK,
+    //! Drop the oldest queued message of the class, its callback is notified with TransmitStatusTypes::DROPPED
+    DROP_OLDEST,
+    //! Turn the new message away
+    REJECT
+};
+
+//!
+//! \brief How queued classes share the link
+//!
+enum class TransmitSchedulingPolicy
+{
+    //! Always serve the highest class with messages waiting
+    STRICT,
+    //! Serve classes in proportion to their weights, higher classes first within each round
+    WEIGHTED
+};
+
+//!
+//! \brief Outcome of handing a message to the radio
+//!
+enum class TransmitQueueResult
+{
+    ACCEPTED,
+    QUEUE_FULL,
+    TIMED_OUT,
+    PAYLOAD_TOO_LARGE
+};
+
+//!
+//! \brief Counters kept for each class of the transmit queue
+//!
+struct TransmitQueueStats
+{
+    //! Messages waiting now
+    size_t depth;
+    //! Most messages that have waited at once
+    size_t maxDepth;
+    //! Messages handed to the link, including those that never had to wait
+    uint64_t sent;
+    //! Messages dropped from a full queue
+    uint64_t dropped;
+    //! Messages replaced by a newer one with the same coalescing key
+    uint64_t superseded;
+    //! Messages dropped because their time to live passed before they could be sent
+    uint64_t expired;
+    //! Time sent messages spent waiting, divide by sent for the mean
+    std::chrono::microseconds totalLatency;
+    //! Longest a sent message waited
+    std::chrono::microseconds maxLatency;
+};
+
+//!
+//! \brief Transmit request waiting on a free frame id or room in the link's transmit buffer
+//!
+struct PendingFrame
+{
+    std::vector<uint8_t> data;
+    uint64_t addr;
+    std::function<void(const ATData::TransmitStatus &)> callback;
+    TransmitPriority priority;
+    TransmitOptions options;
+    std::chrono::steady_clock::time_point enqueued;
+    //! Time the message expires, only meaningful if options.timeToLive is set
+    std::chrono::steady_clock::time_point deadline;
+
+    bool Expired(const std::chrono::steady_clock::time_point &now) const
+    {
+        return options.timeToLive.count() > 0 && now >= deadline;
+    }
+};
+
+//!
+//! \brief Pending transmit requests, one FIFO per TransmitPriority each bounded to a configurable depth.
+//!
+//! Front and Pop agree on which class is served next, as chosen by the scheduling policy.
+//!
+//! The queue performs no locking, the owner is responsible for synchronizing access.
+//!
+class TransmitQueue
+{
+private:
+
+    std::deque<PendingFrame> m_Frames[NUM_TRANSMIT_PRIORITIES];
+    TransmitQueueStats m_Stats[NUM_TRANSMIT_PRIORITIES];
+    size_t m_Size;
+
+    size_t m_Depth;
+    TransmitQueuePolicy m_Policy;
+    std::chrono::milliseconds m_BlockTimeout;
+
+    TransmitSchedulingPolicy m_Scheduling;
+    unsigned int m_Weights[NUM_TRANSMIT_PRIORITIES];
+    unsigned int m_Credits[NUM_TRANSMIT_PRIORITIES];
+
+public:
+
+    //!
+    //! \param depth Number of messages that may wait at once in each class
+    //! \param policy Policy applied when a message arrives at a full class
+    //! \param blockTimeout Longest a sender waits for room under TransmitQueuePolicy::BLOCK
+    //!
+    TransmitQueue(size_t depth, TransmitQueuePolicy policy, const std::chrono::milliseconds &blockTimeout) :
+        m_Size(0),
+        m_Depth(depth),
+        m_Policy(policy),
+        m_BlockTimeout(blockTimeout),
+        m_Scheduling(TransmitSchedulingPolicy::STRICT)
+    {
+        for(size_t i = 0 ; i < NUM_TRANSMIT_PRIORITIES ; i++) {
+            m_Stats[i] = TransmitQueueStats();
+            m_Weights[i] = 1;
+            m_Credits[i] = 1;
+        }
+    }
+
+    void Configure(size_t depth, TransmitQueuePolicy policy, const std::chrono::milliseconds &blockTimeout)
+    {
+        m_Depth = depth;
+        m_Policy = policy;
+        m_BlockTimeout = blockTimeout;
+    }
+
+    //!
+    //! \brief Set how classes share the link
+    //! \param scheduling Scheduling policy
+    //! \param weights Messages each class may send per round under TransmitSchedulingPolicy::WEIGHTED, indexed by
+    //! TransmitPriority, a weight of 0 is treated as 1
+    //!
+    void SetScheduling(TransmitSchedulingPolicy scheduling, const std::vector<unsigned int> &weights = {})
+    {
+        m_Scheduling = scheduling;
+        for(size_t i = 0 ; i < NUM_TRANSMIT_PRIORITIES ; i++) {
+            m_Weights[i] = (i < weights.size() && weights[i] > 0) ? weights[i] : 1;
+            m_Credits[i] = m_Weights[i];
+        }
+    }
+
+    size_t Depth() const
+    {
+        return m_Depth;
+    }
+
+    TransmitQueuePolicy Policy() const
+    {
+        return m_Policy;
+    }
+
+    std::chrono::milliseconds BlockTimeout() const
+    {
+        return m_BlockTimeout;
+    }
+
+    size_t Size() const
+    {
+        return m_Size;
+    }
+
+    bool Empty() const
+    {
+        return m_Size == 0;
+    }
+
+    bool Empty(TransmitPriority priority) const
+    {
+        return m_Frames[(int)priority].empty();
+    }
+
+    //!
+    //! \brief Check that no message of the given class or a higher one is waiting
+    //!
+    bool EmptyThrough(TransmitPriority priority) const
+    {
+        for(int i = 0 ; i <= (int)priority ; i++) {
+            if(!m_Frames[i].empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool Full(TransmitPriority priority) const
+    {
+        return m_Frames[(int)priority].size() >= m_Depth;
+    }
+
+    //!
+    //! \brief Message that is served next, the queue must not be empty
+    //!
+    PendingFrame& Front()
+    {
+        return m_Frames[next_class()].front();
+    }
+
+    void Push(PendingFrame &&frame)
+    {
+        int priority = (int)frame.priority;
+        m_Frames[priority].push_back(std::move(frame));
+        m_Size++;
+
+        TransmitQueueStats &stats = m_Stats[priority];
+        stats.depth = m_Frames[priority].size();
+        if(stats.depth > stats.maxDepth) {
+            stats.maxDepth = stats.depth;
+        }
+    }
+
+    //!
+    //! \brief Put a message in place of a queued one of the same class with the same address and coalescing key
+    //!
+    //! The replacement keeps its predecessor's place in the queue and the time it was queued, but not its deadline.
+    //! \param frame Message to queue, set to the message it replaced if one was found
+    //! \return True if a queued message was replaced
+    //!
+    bool Coalesce(PendingFrame &frame)
+    {
+        int priority = (int)frame.priority;
+        for(std::deque<PendingFrame>::iterator it = m_Frames[priority].begin() ; it != m_Frames[priority].end() ; ++it)
+        {
+            if(it->addr == frame.addr && it->options.coalesceKey == frame.options.coalesceKey)
+            {
+                frame.enqueued = it->enqueued;
+                std::swap(*it, frame);
+                m_Stats[priority].superseded++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //!
+    //! \brief Remove the message returned by Front, counting it as sent
+    //! \return The removed message
+    //!
+    PendingFrame Pop()
+    {
+        int priority = next_class();
+        if(m_Credits[priority] > 0) {
+            m_Credits[priority]--;
+        }
+
+        PendingFrame frame = take(priority);
+
+        std::chrono::microseconds waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frame.enqueued);
+        TransmitQueueStats &stats = m_Stats[priority];
+        stats.sent++;
+        stats.totalLatency += waited;
+        if(waited > stats.maxLatency) {
+            stats.maxLatency = waited;
+        }
+        return frame;
+    }
+
+    //!
+    //! \brief Remove the message returned by Front, counting it as expired
+    //! \return The removed message
+    //!
+    PendingFrame Expire()
+    {
+        int priority = next_class();
+        m_Stats[priority].expired++;
+        return take(priority);
+    }
+
+    //!
+    //! \brief Remove the oldest message of a class, counting it as dropped
+    //! \return The removed message
+    //!
+    PendingFrame Drop(TransmitPriority priority)
+    {
+        m_Stats[(int)priority].dropped++;
+        return take((int)priority);
+    }
+
+    //!
+    //! \brief Count a message of the given class that was sent without waiting
+    //!
+    void CountImmediate(TransmitPriority priority)
+    {
+        m_Stats[(int)priority].sent++;
+    }
+
+    TransmitQueueStats Stats(TransmitPriority priority) const
+    {
+        return m_Stats[(int)priority];
+    }
+
+    void Clear()
+    {
+        for(size_t i = 0 ; i < NUM_TRANSMIT_PRIORITIES ; i++) {
+            m_Frames[i].clear();
+            m_Stats[i].depth = 0;
+        }
+        m_Size = 0;
+    }
+
+private:
+
+    PendingFrame take(int priority)
+    {
+        PendingFrame frame = std::move(m_Frames[priority].front());
+        m_Frames[priority].pop_front();
+        m_Size--;
+        m_Stats[priority].depth = m_Frames[priority].size();
+        return frame;
+    }
+
+    int next_class()
+    {
+        if(m_Scheduling == TransmitSchedulingPolicy::WEIGHTED)
+        {
+            for(int pass = 0 ; pass < 2 ; pass++)
+            {
+                for(int i = 0 ; i < NUM_TRANSMIT_PRIORITIES ; i++) {
+                    if(!m_Frames[i].empty() && m_Credits[i] > 0) {
+                        return i;
+                    }
+                }
+
+                // every class with messages waiting used up its share, start the next round
+                for(int i = 0 ; i < NUM_TRANSMIT_PRIORITIES ; i++) {
+                    m_Credits[i] = m_Weights[i];
+                }
+            }
+        }
+
+        for(int i = 0 ; i < NUM_TRANSMIT_PRIORITIES ; i++) {
+            if(!m_Frames[i].empty()) {
+                return i;
+            }
+        }
+        return 0;
+    }
+};
+
+#endif // TRANSMIT_QUEUE_H
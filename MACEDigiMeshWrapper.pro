@@ -5,4 +5,5 @@ SUBDIRS += \
     Demo_DigiMesh \
     MACEDigiMeshWrapper \
     Demo_MACE \
-    common
+    common \
+    bench
@@ -27,7 +27,8 @@ DEFINES += QT_DEPRECATED_WARNINGS
 SOURCES += \
     component.cpp \
     interop_component.cpp \
-    interop.cpp
+    interop.cpp \
+    lz_compressor.cpp
 
 HEADERS +=\
         macewrapper_global.h \
@@ -35,7 +36,12 @@ HEADERS +=\
     component.h \
     interop_component.h \
     interop.h \
-    resource.h
+    resource.h \
+    fragment_reassembler.h \
+    i_compressor.h \
+    lz_compressor.h \
+    sequence_window.h \
+    reliable_sender.h
 
 
 win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../DigiMesh/release/ -lDigiMesh
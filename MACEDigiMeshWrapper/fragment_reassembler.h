@@ -0,0 +1,198 @@
+#ifndef FRAGMENT_REASSEMBLER_H
+#define FRAGMENT_REASSEMBLER_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <chrono>
+
+#define DEFAULT_REASSEMBLY_TIMEOUT_MS 5000
+#define DEFAULT_REASSEMBLY_MAX_MESSAGES 16
+#define DEFAULT_REASSEMBLY_MAX_BYTES 16384
+
+
+/**
+ * @brief Collects the fragments of messages split by the sender until each message is complete.
+ *
+ * Partial messages are keyed by the sender's address and the sender's message id. The buffer is bounded both in the
+ * number of partial messages and the bytes they hold, the oldest partial message is evicted to make room. Messages
+ * that stop receiving fragments are evicted once they are older than the timeout, checked whenever a fragment arrives.
+ *
+ * The reassembler performs no locking, the owner is responsible for synchronizing access.
+ */
+class FragmentReassembler
+{
+private:
+
+    struct PartialMessage
+    {
+        std::vector<std::vector<uint8_t>> fragments;
+        size_t received;
+        size_t bytes;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    typedef std::pair<uint64_t, uint16_t> MessageKey;
+
+    std::map<MessageKey, PartialMessage> m_Partial;
+    size_t m_Bytes;
+
+    std::chrono::milliseconds m_Timeout;
+    size_t m_MaxMessages;
+    size_t m_MaxBytes;
+
+    size_t m_Evicted;
+
+public:
+
+    /**
+     * @brief Constructor
+     * @param timeout [DEFAULT_REASSEMBLY_TIMEOUT_MS] Time a message has to complete from its first fragment
+     * @param maxMessages [DEFAULT_REASSEMBLY_MAX_MESSAGES] Number of partial messages held at once
+     * @param maxBytes [DEFAULT_REASSEMBLY_MAX_BYTES] Bytes held across all partial messages
+     */
+    FragmentReassembler(const std::chrono::milliseconds &timeout = std::chrono::milliseconds(DEFAULT_REASSEMBLY_TIMEOUT_MS), size_t maxMessages = DEFAULT_REASSEMBLY_MAX_MESSAGES, size_t maxBytes = DEFAULT_REASSEMBLY_MAX_BYTES) :
+        m_Bytes(0),
+        m_Timeout(timeout),
+        m_MaxMessages(maxMessages),
+        m_MaxBytes(maxBytes),
+        m_Evicted(0)
+    {
+    }
+
+    /**
+     * @brief Add a fragment
+     * @param addr Address of the sender
+     * @param messageID Sender's id of the message the fragment belongs to
+     * @param index Position of the fragment in the message
+     * @param count Number of fragments in the message
+     * @param data Fragment's data
+     * @param length Length of the fragment's data
+     * @param message Set to the complete message when this fragment completes it
+     * @return True if the message is complete
+     */
+    bool AddFragment(uint64_t addr, uint16_t messageID, uint8_t index, uint8_t count, const uint8_t *data, size_t length, std::vector<uint8_t> &message)
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        evict_expired(now);
+
+        if(count == 0 || index >= count || length > m_MaxBytes)
+        {
+            return false;
+        }
+
+        MessageKey key(addr, messageID);
+        std::map<MessageKey, PartialMessage>::iterator it = m_Partial.find(key);
+        if(it == m_Partial.end())
+        {
+            while(m_Partial.size() >= m_MaxMessages && m_Partial.empty() == false)
+            {
+                evict(oldest());
+            }
+
+            PartialMessage partial;
+            partial.fragments.resize(count);
+            partial.received = 0;
+            partial.bytes = 0;
+            partial.started = now;
+            it = m_Partial.insert(std::make_pair(key, partial)).first;
+        }
+
+        PartialMessage &partial = it->second;
+        if(partial.fragments.size() != count)
+        {
+            // the sender reused the id for a different message, start over
+            evict(it);
+            return AddFragment(addr, messageID, index, count, data, length, message);
+        }
+        if(partial.fragments[index].empty() == false)
+        {
+            // repeated fragment
+            return false;
+        }
+
+        while(m_Bytes + length > m_MaxBytes)
+        {
+            std::map<MessageKey, PartialMessage>::iterator victim = oldest();
+            if(victim == it)
+            {
+                evict(it);
+                return false;
+            }
+            evict(victim);
+        }
+
+        partial.fragments[index].assign(data, data + length);
+        partial.received++;
+        partial.bytes += length;
+        m_Bytes += length;
+
+        if(partial.received < count)
+        {
+            return false;
+        }
+
+        message.clear();
+        message.reserve(partial.bytes);
+        for(size_t i = 0 ; i < partial.fragments.size() ; i++) {
+            message.insert(message.end(), partial.fragments[i].begin(), partial.fragments[i].end());
+        }
+        m_Bytes -= partial.bytes;
+        m_Partial.erase(it);
+        return true;
+    }
+
+    /**
+     * @brief Number of partial messages dropped because they timed out or the buffer was full
+     */
+    size_t Evicted() const
+    {
+        return m_Evicted;
+    }
+
+    size_t Pending() const
+    {
+        return m_Partial.size();
+    }
+
+private:
+
+    std::map<MessageKey, PartialMessage>::iterator oldest()
+    {
+        std::map<MessageKey, PartialMessage>::iterator oldest = m_Partial.begin();
+        for(std::map<MessageKey, PartialMessage>::iterator it = m_Partial.begin() ; it != m_Partial.end() ; ++it) {
+            if(it->second.started < oldest->second.started) {
+                oldest = it;
+            }
+        }
+        return oldest;
+    }
+
+    void evict(std::map<MessageKey, PartialMessage>::iterator it)
+    {
+        m_Bytes -= it->second.bytes;
+        m_Partial.erase(it);
+        m_Evicted++;
+    }
+
+    void evict_expired(const std::chrono::steady_clock::time_point &now)
+    {
+        std::map<MessageKey, PartialMessage>::iterator it = m_Partial.begin();
+        while(it != m_Partial.end())
+        {
+            if(now - it->second.started > m_Timeout)
+            {
+                std::map<MessageKey, PartialMessage>::iterator expired = it;
+                ++it;
+                evict(expired);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+};
+
+#endif // FRAGMENT_REASSEMBLER_H
@@ -0,0 +1,48 @@
+#ifndef I_COMPRESSOR_H
+#define I_COMPRESSOR_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Codec used to shrink DATA packets before they go on the air
+ *
+ * Peers advertise the IDs of the codecs they can decode, a packet is only compressed towards a peer that advertised
+ * the sender's codec. Codecs that differ in any way affecting their output, such as a preset dictionary, must use
+ * different IDs.
+ */
+class ICompressor
+{
+public:
+
+    virtual ~ICompressor()
+    {
+
+    }
+
+    /**
+     * @brief Identifier advertised to peers, 0 is reserved
+     */
+    virtual uint8_t ID() const = 0;
+
+    /**
+     * @brief Compress a buffer
+     * @param data Data to compress
+     * @param length Length of data
+     * @param out Set to the compressed data
+     * @return False if compressing would not make the data smaller, out is then unspecified
+     */
+    virtual bool Compress(const uint8_t *data, size_t length, std::vector<uint8_t> &out) const = 0;
+
+    /**
+     * @brief Decompress a buffer produced by Compress
+     * @param data Data to decompress
+     * @param length Length of data
+     * @param out Set to the decompressed data
+     * @return False if the data is malformed
+     */
+    virtual bool Decompress(const uint8_t *data, size_t length, std::vector<uint8_t> &out) const = 0;
+};
+
+#endif // I_COMPRESSOR_H
@@ -2,6 +2,141 @@
 
 #include "digimesh_radio.h"
 
+#include <algorithm>
+#include <random>
+
+// payload a radio reports for NP without encryption, used until the radio answers the query
+#define DEFAULT_MAX_PAYLOAD 73
+#define FRAGMENT_HEADER_LENGTH 5
+#define MAX_FRAGMENTS 255
+#define MAX_AGGREGATE_ENTRY 255
+#define PACKET_COMPRESSED_FLAG 0x80
+#define PACKET_SEQUENCED_FLAG 0x40
+#define SEQUENCE_HEADER_LENGTH 3
+// v2 resource packets held per sender while waiting on name definitions
+#define MAX_PENDING_NAMED_PACKETS 8
+#define RELIABLE_HEADER_LENGTH 4
+#define RELIABLE_ACK_LENGTH 8
+
+
+static void write_varint(std::vector<uint8_t> &out, uint32_t value)
+{
+    while(value >= 0x80)
+    {
+        out.push_back((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+
+static bool read_varint(const std::vector<uint8_t> &in, size_t &pos, uint32_t &value)
+{
+    value = 0;
+    for(int shift = 0 ; shift < 35 ; shift += 7)
+    {
+        if(pos >= in.size()) {
+            return false;
+        }
+        uint8_t byte = in[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// maps small negative IDs to small varints as well
+static uint32_t zigzag_encode(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+
+static int32_t zigzag_decode(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+
+/**
+ * @brief Decode a resource in the original format, which runs to the end of the packet
+ * @return False if the packet is malformed
+ */
+static bool decode_resource_v1(const std::vector<uint8_t> &msg, ResourceKey &key, ResourceValue &value)
+{
+    size_t pos = 1;
+    while(pos < msg.size())
+    {
+        std::string element = "";
+        while(pos < msg.size() && msg[pos] != '\0') {
+            element += msg[pos];
+            pos++;
+        }
+        pos++;
+        if(pos + 4 > msg.size()) {
+            return false;
+        }
+
+        int ID = 0;
+        for(int i = 0 ; i < 4 ; i++) {
+            ID |= (((uint64_t)msg[pos+i]) << (8*(3-i)));
+        }
+        pos += 4;
+
+        key.AddNameToResourceKey(element.c_str());
+        value.AddValueToResourceKey(ID);
+    }
+    return true;
+}
+
+
+/**
+ * @brief Decode one v2 entry
+ * @param missing Receives name IDs not found in names, the key then lacks those names
+ * @return False if the packet is malformed
+ */
+static bool decode_resource_v2(const std::vector<uint8_t> &msg, size_t &pos, const std::map<uint32_t, std::string> &names, ResourceKey &key, ResourceValue &value, std::set<uint32_t> &missing)
+{
+    uint32_t count;
+    if(!read_varint(msg, pos, count)) {
+        return false;
+    }
+
+    for(uint32_t i = 0 ; i < count ; i++)
+    {
+        uint32_t nameID;
+        uint32_t ID;
+        if(!read_varint(msg, pos, nameID) || !read_varint(msg, pos, ID)) {
+            return false;
+        }
+
+        std::map<uint32_t, std::string>::const_iterator it = names.find(nameID);
+        if(it == names.end()) {
+            missing.insert(nameID);
+        }
+        else {
+            key.AddNameToResourceKey(it->second);
+        }
+        value.AddValueToResourceKey(zigzag_decode(ID));
+    }
+    return true;
+}
+
+
+/**
+ * @brief Transmit statuses of a message sent in several packets, see Interop::make_combined_status
+ */
+struct CombinedStatus
+{
+    std::mutex mutex;
+    size_t remaining;
+    TransmitStatusTypes status;
+    std::function<void(const TransmitStatusTypes &)> cb;
+};
+
 /**
  * @brief Constructor
  *
@@ -12,28 +147,128 @@
  * @param scanForVehicles [false] Indicate if this radio should scan for other MACE vehicles, or rely upon messages sent.
  */
 Interop::Interop(const std::string &port, DigiMeshBaudRates rate, const std::string &nameOfNode, bool scanForNodes) :
+    m_MaxPayload(std::make_shared<std::atomic<size_t>>(DEFAULT_MAX_PAYLOAD)),
+    m_NextMessageID(0),
+    m_Aggregate(false),
+    m_AggregationDelayMS(DEFAULT_AGGREGATION_DELAY_MS),
+    m_ReliableClosed(false),
+    m_SequenceData(false),
+    m_DuplicatesDropped(0),
+    m_LegacyResourceEncoding(true),
+    m_ResponseSlotMS(DEFAULT_RESPONSE_SLOT_MS),
+    m_MaxResponseDelayMS(DEFAULT_MAX_RESPONSE_DELAY_MS),
+    m_ReplyTask(0),
+    m_RepliesClosed(false),
+    m_RegistryVersion(0),
+    m_SyncIntervalMS(0),
+    m_AdvertiseTask(0),
+    m_SyncClosed(false),
+    m_LeaseMS(0),
+    m_LeaseGuard(std::make_shared<LeaseGuard>()),
+    m_LeaseTask(0),
+    m_LeaseClosed(false),
     m_NodeName(nameOfNode)
 {
-    m_Radio = new DigiMeshRadio(port, rate);
+    // random so receivers can tell this run's sequence numbers, name IDs and versions from a previous one's
+    std::random_device random;
+    m_Session = random() & 0xFF;
+    m_NextSequence = random() & 0xFFFF;
+    m_NameEpoch = random() & 0xFF;
+    m_ReplyRandom.seed(random());
+    m_RegistryEpoch = random() & 0xFF;
 
-    m_NIMutex.lock();
-    if(m_NodeName != "")
-    {
-        ((DigiMeshRadio*)m_Radio)->SetATParameterAsync<ATData::Integer<uint8_t>>("AP", ATData::Integer<uint8_t>(1), [this](){
-            ((DigiMeshRadio*)m_Radio)->SetATParameterAsync<ATData::String>("NI", m_NodeName.c_str(), [this](){
-                m_NIMutex.unlock();
-            });
+    // escaped mode keeps payload bytes equal to the start delimiter from breaking frame synchronization
+    m_Radio = new DigiMeshRadio(port, rate, APIModes::ESCAPED);
 
+    std::shared_ptr<std::atomic<size_t>> maxPayload = m_MaxPayload;
+    ((DigiMeshRadio*)m_Radio)->GetATParameterAsync<ATData::Integer<uint16_t>, ShutdownFirstResponse>("NP", [maxPayload](const std::vector<ATData::Integer<uint16_t>> &np){
+        if(np.size() > 0 && np.at(0).Value() > SEQUENCE_HEADER_LENGTH + FRAGMENT_HEADER_LENGTH) {
+            *maxPayload = np.at(0).Value();
+        }
+    });
 
-        });
+    if(m_NodeName != "")
+    {
+        ((DigiMeshRadio*)m_Radio)->SetATParameter<ATData::String>("NI", m_NodeName.c_str());
     }
 
     ((DigiMeshRadio*)m_Radio)->AddMessageHandler([this](const ATData::Message &a){this->on_message_received(a.data, a.addr);});
+
+    m_LeaseGuard->owner = this;
 }
 
 
 Interop::~Interop()
 {
+    // stop retransmitting, messages still unacknowledged are abandoned
+    std::vector<Scheduler::TaskID> retransmitTasks;
+    {
+        std::lock_guard<std::mutex> lock(m_ReliableMutex);
+        m_ReliableClosed = true;
+        for(auto it = m_ReliablePeers.begin() ; it != m_ReliablePeers.end() ; ++it) {
+            if(it->second.retransmitTask != 0) {
+                retransmitTasks.push_back(it->second.retransmitTask);
+                it->second.retransmitTask = 0;
+            }
+        }
+    }
+    for(size_t i = 0 ; i < retransmitTasks.size() ; i++) {
+        Scheduler::Instance().Cancel(retransmitTasks.at(i));
+    }
+
+    Scheduler::TaskID replyTask;
+    {
+        std::lock_guard<std::mutex> lock(m_ReplyMutex);
+        m_RepliesClosed = true;
+        replyTask = m_ReplyTask;
+        m_ReplyTask = 0;
+    }
+    if(replyTask != 0) {
+        Scheduler::Instance().Cancel(replyTask);
+    }
+
+    Scheduler::TaskID advertiseTask;
+    {
+        std::lock_guard<std::mutex> lock(m_SyncMutex);
+        m_SyncClosed = true;
+        advertiseTask = m_AdvertiseTask;
+        m_AdvertiseTask = 0;
+    }
+    if(advertiseTask != 0) {
+        Scheduler::Instance().Cancel(advertiseTask);
+    }
+
+    Scheduler::TaskID leaseTask;
+    {
+        std::lock_guard<std::mutex> lock(m_LeaseMutex);
+        m_LeaseClosed = true;
+        leaseTask = m_LeaseTask;
+        m_LeaseTask = 0;
+    }
+    if(leaseTask != 0) {
+        Scheduler::Instance().Cancel(leaseTask);
+    }
+    {
+        // waits out a check running on the radio's thread, checks handed over but not yet run find no owner
+        std::lock_guard<std::mutex> lock(m_LeaseGuard->mutex);
+        m_LeaseGuard->owner = NULL;
+    }
+
+    // stop the flush tasks, then send whatever they would have
+    std::vector<std::pair<uint64_t, PendingAggregate>> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_AggregationMutex);
+        for(auto it = m_Aggregates.begin() ; it != m_Aggregates.end() ; ++it) {
+            pending.push_back(std::make_pair(it->first, std::move(it->second)));
+        }
+        m_Aggregates.clear();
+        m_Aggregate = false;
+    }
+    for(auto it = pending.begin() ; it != pending.end() ; ++it) {
+        Scheduler::Instance().Cancel(it->second.flushTask);
+        transmit_aggregate(it->first, it->second);
+    }
+
     if(m_NodeName == ""){
         ((DigiMeshRadio*)m_Radio)->SetATParameterAsync<ATData::String>("AP", "-");
     }
@@ -51,19 +286,202 @@ void Interop::AddHandler_Data(const std::function<void (const std::vector<uint8_
 }
 
 
+/**
+ * @brief Add handler to be called with every hop reported for data sent with TransmitOptions::traceRoute
+ *
+ * Hops carry no message id, their destination address tells which send they belong to. The radio also reports route
+ * repairs after a hop failed to acknowledge, those are passed with RouteInformationEvents::NACK.
+ * @param lambda Lambda function accepting the reported hop, called on the link thread
+ */
+void Interop::AddHandler_RouteInformation(const std::function<void (const RouteInformation &)> &lambda)
+{
+    ((DigiMeshRadio*)m_Radio)->AddRouteInformationHandler(lambda);
+}
+
+
 /**
  * @brief Broadcast data to all nodes
  * @param data Data to broadcast out
+ * @param priority [TELEMETRY] Class the data is queued in
+ * @param options [TransmitOptions()] Transmit options, set broadcastRadius to limit how many hops the data travels
+ */
+void Interop::BroadcastData(const std::vector<uint8_t> &data, TransmitPriority priority, const TransmitOptions &options)
+{
+    send_data(BROADCAST_ADDRESS, data, nullptr, priority, options);
+}
+
+
+/**
+ * @brief Pack small DATA messages bound for the same destination into shared frames
+ *
+ * A destination's messages are held until the next one would not fit in the radio's maximum payload, or until
+ * the flush delay after the first of them passes.
+ * @param enabled True to aggregate, false sends every message in its own frame
+ * @param flushDelayMS [DEFAULT_AGGREGATION_DELAY_MS] Longest a message is held
  */
-void Interop::BroadcastData(const std::vector<uint8_t> &data)
+void Interop::SetAggregation(bool enabled, int flushDelayMS)
 {
-    //construct packet, putting the packet type at head
-    std::vector<uint8_t> packet = {(uint8_t)PacketTypes::DATA};
-    for(int i = 0 ; i < data.size() ; i++) {
-        packet.push_back(data.at(i));
+    std::vector<uint64_t> held;
+    {
+        std::lock_guard<std::mutex> lock(m_AggregationMutex);
+        m_Aggregate = enabled;
+        m_AggregationDelayMS = flushDelayMS;
+
+        if(!enabled) {
+            for(auto it = m_Aggregates.cbegin() ; it != m_Aggregates.cend() ; ++it) {
+                held.push_back(it->first);
+            }
+        }
     }
 
-    ((DigiMeshRadio*)m_Radio)->SendMessage(packet);
+    for(size_t i = 0 ; i < held.size() ; i++) {
+        flush_aggregate(held.at(i));
+    }
+}
+
+
+/**
+ * @brief Compress DATA packets sent to peers that advertise the same codec
+ *
+ * This node's codec is advertised to each peer the first time data is sent to it, and in reply to a peer's
+ * advertisement. Packets are only compressed when that makes them smaller.
+ * @param compressor Codec to use, NULL disables compression
+ */
+void Interop::SetCompressor(const std::shared_ptr<ICompressor> &compressor)
+{
+    std::lock_guard<std::mutex> lock(m_CompressionMutex);
+    m_Compressor = compressor;
+
+    // every peer has to learn of the change
+    m_AdvertisedTo.clear();
+}
+
+
+/**
+ * @brief Stamp DATA path packets with a sequence header, so receivers drop repeated copies before handling them
+ *
+ * Disabled by default, nodes that predate the header can't decode stamped packets. Headers are always
+ * understood on reception, enable stamping once every node on the network does.
+ * @param enabled True to stamp packets
+ */
+void Interop::SetSequenceNumbering(bool enabled)
+{
+    m_SequenceData = enabled;
+}
+
+
+/**
+ * @brief Number of repeated DATA path packets dropped on reception
+ */
+size_t Interop::DuplicatesDropped() const
+{
+    return m_DuplicatesDropped;
+}
+
+
+/**
+ * @brief Announce and remove resources in the original format, spelling out every name
+ *
+ * The original format is used by default, nodes that predate the compact v2 format can't decode it. Both formats
+ * are always understood on reception, switch to v2 once every node on the network does.
+ * The original format carries a single resource per packet, so only v2 batches the replies to contained resource
+ * requests, packing as many resources into each packet as the radio's payload allows.
+ * @param legacy True to send the original format, false the compact v2 format
+ */
+void Interop::SetLegacyResourceEncoding(bool legacy)
+{
+    std::lock_guard<std::mutex> lock(m_NameMutex);
+    m_LegacyResourceEncoding = legacy;
+}
+
+
+/**
+ * @brief Spread replies to contained resource requests over a random delay, so nodes don't all answer at once
+ *
+ * The delay is drawn uniformly up to slotMS for every node known to hold resources, including this one, capped
+ * at maxDelayMS.
+ * Items another node announces while this node's reply is pending, or that are requested again, are only sent
+ * once.
+ * @param slotMS [DEFAULT_RESPONSE_SLOT_MS] Delay allowed per node, 0 replies straight away
+ * @param maxDelayMS [DEFAULT_MAX_RESPONSE_DELAY_MS] Longest delay
+ */
+void Interop::SetResponseJitter(int slotMS, int maxDelayMS)
+{
+    std::lock_guard<std::mutex> lock(m_ReplyMutex);
+    m_ResponseSlotMS = slotMS;
+    m_MaxResponseDelayMS = maxDelayMS;
+}
+
+
+/**
+ * @brief Set how often this node broadcasts the version of its resources
+ *
+ * A node hearing a version it doesn't hold asks for the changes since the version it does, or for every resource
+ * if it holds none from the advertiser's current run, so keeping in sync costs a few bytes per interval when
+ * nothing changes. Advertising is off by default, nodes that predate versioning can't decode the advertisement.
+ * Every node answers sync requests regardless.
+ * @param intervalMS [DEFAULT_SYNC_INTERVAL_MS] Time between advertisements, 0 stops advertising
+ */
+void Interop::SetSyncInterval(int intervalMS)
+{
+    Scheduler::TaskID previous;
+    {
+        std::lock_guard<std::mutex> lock(m_SyncMutex);
+        if(m_SyncClosed) {
+            return;
+        }
+        previous = m_AdvertiseTask;
+        m_AdvertiseTask = 0;
+        m_SyncIntervalMS = intervalMS;
+
+        if(intervalMS > 0)
+        {
+            m_AdvertiseTask = Scheduler::Instance().SchedulePeriodic(intervalMS, [this](){
+                send_version(PacketTypes::VERSION_ADVERTISE, BROADCAST_ADDRESS);
+            });
+        }
+    }
+
+    // the advertisement doesn't take m_SyncMutex, but waiting on it while holding the lock is still best avoided
+    if(previous != 0) {
+        Scheduler::Instance().Cancel(previous);
+    }
+}
+
+
+/**
+ * @brief Set how long a node that advertises its version may go unheard before its resources are removed
+ *
+ * Every packet from a node renews its lease, and its version advertisements keep it renewed while it is otherwise
+ * quiet, so the lease should span a few of the node's sync intervals. A shorter lease detects lost nodes sooner,
+ * at the cost of advertising more often. Only nodes that advertise are held to a lease, leases are off by default.
+ * Removals are reported on the radio's thread, like every other resource callback.
+ * @param leaseMS [DEFAULT_LEASE_MS] Lease, 0 keeps resources until they are removed explicitly
+ */
+void Interop::SetLease(int leaseMS)
+{
+    Scheduler::TaskID previous;
+    {
+        std::lock_guard<std::mutex> lock(m_LeaseMutex);
+        if(m_LeaseClosed) {
+            return;
+        }
+        previous = m_LeaseTask;
+        m_LeaseTask = 0;
+        m_LeaseMS = leaseMS;
+
+        if(leaseMS > 0)
+        {
+            m_LeaseTask = Scheduler::Instance().SchedulePeriodic(std::max(leaseMS / LEASE_CHECKS, 1), [this](){
+                check_leases();
+            });
+        }
+    }
+
+    // waiting on a check in progress while holding the lock is best avoided
+    if(previous != 0) {
+        Scheduler::Instance().Cancel(previous);
+    }
 }
 
 
@@ -89,195 +507,1378 @@ void Interop::RequestContainedResources(const ResourceKey &key) const
 }
 
 
-void Interop::SendDataToAddress(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb)
+/**
+ * @brief Send data to a node
+ * @param addr Address to send to
+ * @param data Data to send
+ * @param cb Called with the transmit status, may be empty
+ * @param priority [TELEMETRY] Class the data is queued in
+ * @param options [TransmitOptions()] Transmit options applied to every frame carrying the data
+ */
+void Interop::SendDataToAddress(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb, TransmitPriority priority, const TransmitOptions &options)
 {
     //if sending to self, notify self
     if(addr == 0) {
         Notify<const std::vector<uint8_t>&>(m_Handlers_Data, data);
     }
 
-    //construct packet, putting the packet type at head
-    std::vector<uint8_t> packet = {(uint8_t)PacketTypes::DATA};
-    for(int i = 0 ; i < data.size() ; i++) {
-        packet.push_back(data.at(i));
-    }
-
-    ((DigiMeshRadio*)m_Radio)->SendMessage(packet, addr, [cb](const ATData::TransmitStatus status){
-        cb(status.status);
-    });
+    send_data(addr, data, cb, priority, options);
 }
 
 
 /**
- * @brief Logic to perform upon reception of a message
- * @param msg Message received
+ * @brief Send data to a node, resending it until the node acknowledges it
+ *
+ * Each destination holds up to RELIABLE_WINDOW unacknowledged messages. A message is resent when its retransmit
+ * timeout passes or when later messages are acknowledged ahead of it, and given up on after
+ * RELIABLE_MAX_TRANSMISSIONS transmissions. Only unicasts small enough for a single frame are supported.
+ * @param addr Address to send to
+ * @param data Data to send
+ * @param cb Called with SUCCESS once acknowledged, or TIMEOUT once given up on, may be empty
+ * @param priority [TELEMETRY] Class the data is queued in
+ * @return False if the destination already holds RELIABLE_WINDOW unacknowledged messages
  */
-void Interop::on_message_received(const std::vector<uint8_t> &msg, uint64_t addr)
+bool Interop::SendReliableDataToAddress(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb, TransmitPriority priority)
 {
-    PacketTypes packetType = (PacketTypes)msg.at(0);
-    switch(packetType) {
-        case PacketTypes::DATA:
-            {
-            std::vector<uint8_t> data;
-            for(int i = 1 ; i < msg.size() ; i++) {
-                data.push_back(msg.at(i));
-            }
-            Notify<const std::vector<uint8_t>&>(m_Handlers_Data, data);
-            break;
+    //if sending to self, notify self
+    if(addr == 0)
+    {
+        Notify<const std::vector<uint8_t>&>(m_Handlers_Data, data);
+        if(cb) {
+            cb(TransmitStatusTypes::SUCCESS);
         }
-        case PacketTypes::COMPONENT_ITEM_PRESENT:
-        {
-            ResourceKey key;
-            ResourceValue value;
-
-            int pos = 1;
-
-            //iterate over message pulling every component/value
-            while(pos < msg.size())
-            {
-                std::string element = "";
-                while(msg[pos] != '\0') {
-                    element += msg[pos];
-                    pos++;
-                }
-                int ID = 0;
-                pos++;
-                for(int i = 0 ; i < 4 ; i++) {
-                    ID |= (((uint64_t)msg[pos+i]) << (8*(3-i)));
-                }
-                pos += 4;
+        return true;
+    }
 
-                key.AddNameToResourceKey(element.c_str());
-                value.AddValueToResourceKey(ID);
-            }
+    if(addr == BROADCAST_ADDRESS)
+    {
+        throw std::runtime_error("Transmit error, reliable delivery needs a unicast address");
+    }
+    if(data.size() + RELIABLE_HEADER_LENGTH > *m_MaxPayload)
+    {
+        throw std::runtime_error("Transmit error, data too large for reliable delivery");
+    }
 
-            onNewRemoteComponentItem(key, value, addr);
-            break;
+    ReliableSender::Message message;
+    uint8_t session;
+    {
+        std::lock_guard<std::mutex> lock(m_ReliableMutex);
+        ReliablePeer &peer = m_ReliablePeers[addr];
+        if(peer.sender.Full()) {
+            return false;
         }
-        case PacketTypes::CONTAINED_VECHILES_REQUEST:
-        {
-            ResourceKey key;
-            int pos = 1;
+        message = peer.sender.Push(data, priority, cb, std::chrono::steady_clock::now());
+        session = peer.sender.Session();
+        arm_retransmit_timer(addr, peer);
+    }
 
-            //iterate over message pulling every component/value
-            while(pos < msg.size())
-            {
-                std::string element = "";
-                while(msg[pos] != '\0') {
-                    element += msg[pos];
-                    pos++;
-                }
-                pos++;
+    send_reliable_message(addr, session, message);
+    return true;
+}
 
-                key.AddNameToResourceKey(element.c_str());
-            }
 
-            std::vector<std::tuple<ResourceKey, ResourceValue>> contained = RetrieveComponentItems(key, true);
+void Interop::send_data(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb, TransmitPriority priority, const TransmitOptions &options)
+{
+    // room is left for the sequence header send_packet stamps on
+    size_t maxPayload = *m_MaxPayload - (m_SequenceData ? SEQUENCE_HEADER_LENGTH : 0);
 
-            for(auto it = contained.cbegin() ; it != contained.cend() ; ++it) {
-                send_item_present_message(std::get<0>(*it), std::get<1>(*it));
-            }
-            break;
+    // commands go out immediately and bulk transfers gain little, only telemetry is worth holding back. An aggregate
+    // shares one set of transmit options, so messages asking for their own, coalescing included, are sent alone
+    if(priority == TransmitPriority::TELEMETRY && options == TransmitOptions() && data.size() <= MAX_AGGREGATE_ENTRY && data.size() + 2 <= maxPayload)
+    {
+        if(aggregate_data(addr, data, cb, maxPayload)) {
+            return;
         }
-        case PacketTypes::REMOVE_COMPONENT_ITEM:
-        {
-            ResourceKey key;
-            ResourceValue value;
+    }
+    else if(priority == TransmitPriority::TELEMETRY)
+    {
+        // anything held for this destination was given first and has to go out first
+        flush_aggregate(addr);
+    }
 
-            int pos = 1;
+    if(data.size() + 1 <= maxPayload)
+    {
+        //construct packet, putting the packet type at head
+        std::vector<uint8_t> packet;
+        packet.reserve(data.size() + 1);
+        packet.push_back((uint8_t)PacketTypes::DATA);
+        packet.insert(packet.end(), data.begin(), data.end());
+
+        send_packet(addr, packet, cb, priority, options);
+        return;
+    }
+
+    size_t fragmentLength = maxPayload - FRAGMENT_HEADER_LENGTH;
+    size_t count = (data.size() + fragmentLength - 1) / fragmentLength;
+    if(count > MAX_FRAGMENTS)
+    {
+        throw std::runtime_error("Transmit error, data too large to fragment");
+    }
+
+    uint16_t messageID = m_NextMessageID++;
+
+    // each fragment would replace the one before it, a fragmented message is never coalesced
+    TransmitOptions fragmentOptions = options;
+    fragmentOptions.coalesceKey = 0;
+
+    std::function<void(const TransmitStatusTypes &)> fragmentCallback;
+    if(cb) {
+        fragmentCallback = make_combined_status(count, cb);
+    }
+
+    for(size_t i = 0 ; i < count ; i++)
+    {
+        size_t start = i * fragmentLength;
+        size_t end = std::min(start + fragmentLength, data.size());
+
+        std::vector<uint8_t> packet;
+        packet.reserve(FRAGMENT_HEADER_LENGTH + end - start);
+        packet.push_back((uint8_t)PacketTypes::DATA_FRAGMENT);
+        packet.push_back((messageID >> 8) & 0xFF);
+        packet.push_back(messageID & 0xFF);
+        packet.push_back((uint8_t)i);
+        packet.push_back((uint8_t)count);
+        packet.insert(packet.end(), data.begin() + start, data.begin() + end);
+
+        send_packet(addr, packet, fragmentCallback, priority, fragmentOptions);
+    }
+}
+
+
+/**
+ * @brief Combine the transmit statuses of a message sent in several packets into one
+ * @param count Number of packets, at least 1
+ * @param cb Called once every packet's status is in, with the first failing status or SUCCESS
+ * @return Callback to give each packet
+ */
+std::function<void(const TransmitStatusTypes &)> Interop::make_combined_status(size_t count, const std::function<void(const TransmitStatusTypes &)> &cb)
+{
+    std::shared_ptr<CombinedStatus> combined = std::make_shared<CombinedStatus>();
+    combined->remaining = count;
+    combined->status = TransmitStatusTypes::SUCCESS;
+    combined->cb = cb;
+
+    return [combined](const TransmitStatusTypes &status){
+        bool done;
+        {
+            std::lock_guard<std::mutex> lock(combined->mutex);
+            if(combined->status == TransmitStatusTypes::SUCCESS) {
+                combined->status = status;
+            }
+            combined->remaining--;
+            done = combined->remaining == 0;
+        }
+        if(done) {
+            combined->cb(combined->status);
+        }
+    };
+}
+
+
+bool Interop::aggregate_data(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb, size_t maxPayload)
+{
+    PendingAggregate full;
+    {
+        std::lock_guard<std::mutex> lock(m_AggregationMutex);
+        if(!m_Aggregate) {
+            return false;
+        }
+
+        PendingAggregate &pending = m_Aggregates[addr];
+        if(!pending.packet.empty() && pending.packet.size() + 1 + data.size() > maxPayload)
+        {
+            // the pending flush task stays with the destination and covers the messages that follow
+            full.packet.swap(pending.packet);
+            full.callbacks.swap(pending.callbacks);
+        }
+
+        if(pending.packet.empty())
+        {
+            pending.packet.reserve(maxPayload);
+            pending.packet.push_back((uint8_t)PacketTypes::AGGREGATE);
+        }
+        pending.packet.push_back((uint8_t)data.size());
+        pending.packet.insert(pending.packet.end(), data.begin(), data.end());
+        pending.callbacks.push_back(cb);
+
+        if(pending.flushTask == 0)
+        {
+            pending.flushTask = Scheduler::Instance().Schedule(m_AggregationDelayMS, [this, addr](){
+                PendingAggregate due;
+                {
+                    std::lock_guard<std::mutex> lock(m_AggregationMutex);
+                    auto it = m_Aggregates.find(addr);
+                    if(it == m_Aggregates.end()) {
+                        return;
+                    }
+                    due = std::move(it->second);
+                    m_Aggregates.erase(it);
+                }
+                transmit_aggregate(addr, due);
+            });
+        }
+    }
+
+    transmit_aggregate(addr, full);
+    return true;
+}
+
+
+void Interop::flush_aggregate(uint64_t addr)
+{
+    PendingAggregate held;
+    {
+        std::lock_guard<std::mutex> lock(m_AggregationMutex);
+        auto it = m_Aggregates.find(addr);
+        if(it == m_Aggregates.end()) {
+            return;
+        }
+        held.packet.swap(it->second.packet);
+        held.callbacks.swap(it->second.callbacks);
+    }
+    transmit_aggregate(addr, held);
+}
+
+
+void Interop::transmit_aggregate(uint64_t addr, PendingAggregate &aggregate)
+{
+    if(aggregate.callbacks.empty()) {
+        return;
+    }
+
+    if(aggregate.callbacks.size() == 1)
+    {
+        // a lone message goes out as plain DATA, dropping its length prefix
+        aggregate.packet[1] = (uint8_t)PacketTypes::DATA;
+        aggregate.packet.erase(aggregate.packet.begin());
+    }
+
+    bool anyCallback = false;
+    for(size_t i = 0 ; i < aggregate.callbacks.size() ; i++) {
+        if(aggregate.callbacks.at(i)) {
+            anyCallback = true;
+        }
+    }
+
+    if(anyCallback)
+    {
+        std::vector<std::function<void(const TransmitStatusTypes &)>> callbacks;
+        callbacks.swap(aggregate.callbacks);
+        send_packet(addr, aggregate.packet, [callbacks](const TransmitStatusTypes &status){
+            for(size_t i = 0 ; i < callbacks.size() ; i++) {
+                if(callbacks.at(i)) {
+                    callbacks.at(i)(status);
+                }
+            }
+        }, TransmitPriority::TELEMETRY);
+    }
+    else
+    {
+        send_packet(addr, aggregate.packet, nullptr, TransmitPriority::TELEMETRY);
+    }
+}
+
+
+/**
+ * @brief Hand a protocol packet to the radio without throwing, for senders on the link's or scheduler's thread
+ *
+ * A packet the radio can't take is dropped with a log line, every caller's protocol asks again later.
+ * @return True if the radio took the packet
+ */
+bool Interop::send_packet_nothrow(uint64_t addr, const std::vector<uint8_t> &packet)
+{
+    const char *reason;
+    switch(((DigiMeshRadio*)m_Radio)->TrySendMessage(packet, addr))
+    {
+    case TransmitQueueResult::ACCEPTED:
+        return true;
+    case TransmitQueueResult::PAYLOAD_TOO_LARGE:
+        reason = "payload too large";
+        break;
+    case TransmitQueueResult::QUEUE_FULL:
+        reason = "transmit queue is full";
+        break;
+    case TransmitQueueResult::TIMED_OUT:
+    default:
+        reason = "timed out waiting on the transmit queue";
+        break;
+    }
+
+    printf("Interop packet type %d to %llx dropped, %s\n", packet.empty() ? -1 : (int)packet.at(0), (unsigned long long)addr, reason);
+    return false;
+}
+
+
+void Interop::send_packet(uint64_t addr, std::vector<uint8_t> &packet, const std::function<void(const TransmitStatusTypes &)> &cb, TransmitPriority priority, const TransmitOptions &options)
+{
+    // broadcasts reach peers with differing codecs, only unicasts are compressed
+    std::shared_ptr<ICompressor> compressor;
+    bool advertise = false;
+    if(addr != BROADCAST_ADDRESS && addr != 0)
+    {
+        std::lock_guard<std::mutex> lock(m_CompressionMutex);
+        if(m_Compressor != NULL)
+        {
+            advertise = m_AdvertisedTo.insert(addr).second;
+
+            auto it = m_PeerCodecs.find(addr);
+            if(it != m_PeerCodecs.end() && std::find(it->second.begin(), it->second.end(), m_Compressor->ID()) != it->second.end()) {
+                compressor = m_Compressor;
+            }
+        }
+    }
+
+    if(advertise) {
+        send_capabilities(addr);
+    }
+
+    if(compressor != NULL)
+    {
+        std::vector<uint8_t> compressed;
+        compressed.reserve(packet.size());
+        compressed.push_back(packet[0] | PACKET_COMPRESSED_FLAG);
+
+        std::vector<uint8_t> body;
+        if(compressor->Compress(packet.data() + 1, packet.size() - 1, body))
+        {
+            compressed.insert(compressed.end(), body.begin(), body.end());
+            packet.swap(compressed);
+        }
+    }
+
+    PacketTypes type = (PacketTypes)(packet[0] & ~PACKET_COMPRESSED_FLAG);
+    if(m_SequenceData && (type == PacketTypes::DATA || type == PacketTypes::DATA_FRAGMENT || type == PacketTypes::AGGREGATE))
+    {
+        uint16_t sequence = m_NextSequence++;
+        uint8_t header[SEQUENCE_HEADER_LENGTH] = {m_Session, (uint8_t)(sequence >> 8), (uint8_t)(sequence & 0xFF)};
+        packet[0] |= PACKET_SEQUENCED_FLAG;
+        packet.insert(packet.begin() + 1, header, header + SEQUENCE_HEADER_LENGTH);
+    }
+
+    if(cb)
+    {
+        ((DigiMeshRadio*)m_Radio)->SendMessage(packet, addr, [cb](const ATData::TransmitStatus status){
+            cb(status.status);
+        }, priority, options);
+    }
+    else
+    {
+        ((DigiMeshRadio*)m_Radio)->SendMessage(packet, addr, nullptr, priority, options);
+    }
+}
+
+
+void Interop::send_reliable_message(uint64_t addr, uint8_t session, const ReliableSender::Message &message)
+{
+    std::vector<uint8_t> packet;
+    packet.reserve(RELIABLE_HEADER_LENGTH + message.data.size());
+    packet.push_back((uint8_t)PacketTypes::RELIABLE_DATA);
+    packet.push_back(session);
+    packet.push_back((message.sequence >> 8) & 0xFF);
+    packet.push_back(message.sequence & 0xFF);
+    packet.insert(packet.end(), message.data.begin(), message.data.end());
+
+    try
+    {
+        send_packet(addr, packet, nullptr, message.priority);
+    }
+    catch(const std::runtime_error &)
+    {
+        // the radio could not take it right now, the retransmit timer sends it again
+    }
+}
+
+
+void Interop::arm_retransmit_timer(uint64_t addr, ReliablePeer &peer)
+{
+    if(m_ReliableClosed || peer.retransmitTask != 0 || peer.sender.Empty()) {
+        return;
+    }
+
+    std::chrono::milliseconds delay = peer.sender.TimeUntilDue(std::chrono::steady_clock::now());
+    peer.retransmitTask = Scheduler::Instance().Schedule((int)delay.count(), [this, addr](){
+        on_retransmit_timer(addr);
+    });
+}
+
+
+void Interop::on_retransmit_timer(uint64_t addr)
+{
+    std::vector<ReliableSender::Message> retransmit;
+    std::vector<ReliableSender::Message> failed;
+    uint8_t session;
+    {
+        std::lock_guard<std::mutex> lock(m_ReliableMutex);
+        auto it = m_ReliablePeers.find(addr);
+        if(it == m_ReliablePeers.end()) {
+            return;
+        }
+        ReliablePeer &peer = it->second;
+        peer.retransmitTask = 0;
+        if(m_ReliableClosed) {
+            return;
+        }
+
+        peer.sender.OnTimer(std::chrono::steady_clock::now(), retransmit, failed);
+        session = peer.sender.Session();
+        arm_retransmit_timer(addr, peer);
+    }
+
+    for(size_t i = 0 ; i < retransmit.size() ; i++) {
+        send_reliable_message(addr, session, retransmit.at(i));
+    }
+    for(size_t i = 0 ; i < failed.size() ; i++) {
+        if(failed.at(i).cb) {
+            failed.at(i).cb(TransmitStatusTypes::TIMEOUT);
+        }
+    }
+}
+
+
+void Interop::on_reliable_data(const std::vector<uint8_t> &msg, uint64_t addr)
+{
+    if(msg.size() < RELIABLE_HEADER_LENGTH) {
+        return;
+    }
+    uint8_t session = msg.at(1);
+    uint16_t sequence = (msg.at(2) << 8) | msg.at(3);
+
+    bool fresh = accept_sequence(m_ReliableSources, addr, session, sequence);
+
+    // acknowledged even when repeated, the earlier acknowledgement may have been lost
+    const SequenceWindow &window = m_ReliableSources.at(addr).window;
+    uint16_t expected = window.Expected();
+    uint32_t selective = window.Selective();
+    std::vector<uint8_t> ack;
+    ack.reserve(RELIABLE_ACK_LENGTH);
+    ack.push_back((uint8_t)PacketTypes::RELIABLE_ACK);
+    ack.push_back(session);
+    ack.push_back((expected >> 8) & 0xFF);
+    ack.push_back(expected & 0xFF);
+    for(int i = 3 ; i >= 0 ; i--) {
+        ack.push_back((selective >> (8*i)) & 0xFF);
+    }
+    try
+    {
+        send_packet(addr, ack, nullptr, TransmitPriority::COMMAND);
+    }
+    catch(const std::runtime_error &)
+    {
+        // the sender's retransmission is acknowledged instead
+    }
+
+    if(fresh)
+    {
+        std::vector<uint8_t> data(msg.begin() + RELIABLE_HEADER_LENGTH, msg.end());
+        Notify<const std::vector<uint8_t>&>(m_Handlers_Data, data);
+    }
+}
+
+
+void Interop::on_reliable_ack(const std::vector<uint8_t> &msg, uint64_t addr)
+{
+    if(msg.size() < RELIABLE_ACK_LENGTH) {
+        return;
+    }
+    uint8_t session = msg.at(1);
+    uint16_t expected = (msg.at(2) << 8) | msg.at(3);
+    uint32_t selective = 0;
+    for(int i = 0 ; i < 4 ; i++) {
+        selective = (selective << 8) | msg.at(4 + i);
+    }
+
+    std::vector<ReliableSender::Message> acked;
+    std::vector<ReliableSender::Message> retransmit;
+    {
+        std::lock_guard<std::mutex> lock(m_ReliableMutex);
+        auto it = m_ReliablePeers.find(addr);
+        if(it == m_ReliablePeers.end()) {
+            return;
+        }
+        it->second.sender.OnAck(session, expected, selective, std::chrono::steady_clock::now(), acked, retransmit);
+    }
+
+    for(size_t i = 0 ; i < retransmit.size() ; i++) {
+        send_reliable_message(addr, session, retransmit.at(i));
+    }
+    for(size_t i = 0 ; i < acked.size() ; i++) {
+        if(acked.at(i).cb) {
+            acked.at(i).cb(TransmitStatusTypes::SUCCESS);
+        }
+    }
+}
+
+
+bool Interop::accept_sequence(std::map<uint64_t, SenderWindow> &senders, uint64_t addr, uint8_t session, uint16_t sequence)
+{
+    auto it = senders.find(addr);
+    if(it == senders.end()) {
+        it = senders.insert(std::make_pair(addr, SenderWindow())).first;
+        it->second.session = session;
+    }
+
+    SenderWindow &sender = it->second;
+    if(sender.session != session)
+    {
+        // the sender restarted, its sequence numbers start over
+        sender.session = session;
+        sender.window.Reset();
+    }
+    return sender.window.Accept(sequence);
+}
+
+
+void Interop::send_capabilities(uint64_t addr)
+{
+    std::vector<uint8_t> packet;
+    packet.push_back((uint8_t)PacketTypes::CAPABILITIES);
+    {
+        std::lock_guard<std::mutex> lock(m_CompressionMutex);
+        if(m_Compressor != NULL) {
+            packet.push_back(m_Compressor->ID());
+        }
+    }
+
+    ((DigiMeshRadio*)m_Radio)->SendMessage(packet, addr);
+}
+
+
+bool Interop::decompress_packet(const std::vector<uint8_t> &msg, uint64_t addr, std::vector<uint8_t> &packet)
+{
+    std::shared_ptr<ICompressor> compressor;
+    {
+        std::lock_guard<std::mutex> lock(m_CompressionMutex);
+        compressor = m_Compressor;
+    }
+
+    std::vector<uint8_t> body;
+    if(compressor == NULL || !compressor->Decompress(msg.data() + 1, msg.size() - 1, body))
+    {
+        // the sender holds stale capabilities for this node, correct them
+        {
+            std::lock_guard<std::mutex> lock(m_CompressionMutex);
+            m_AdvertisedTo.insert(addr);
+        }
+        send_capabilities(addr);
+        return false;
+    }
+
+    packet.reserve(body.size() + 1);
+    packet.push_back(msg.at(0) & ~PACKET_COMPRESSED_FLAG);
+    packet.insert(packet.end(), body.begin(), body.end());
+    return true;
+}
+
+
+/**
+ * @brief Logic to perform upon reception of a message
+ * @param msg Message received
+ */
+void Interop::on_message_received(const std::vector<uint8_t> &msg, uint64_t addr)
+{
+    renew_lease(addr);
+
+    if(msg.at(0) & PACKET_SEQUENCED_FLAG)
+    {
+        if(msg.size() < 1 + SEQUENCE_HEADER_LENGTH) {
+            return;
+        }
+
+        // checked before anything is decompressed or dispatched, a repeat costs only the window lookup
+        uint16_t sequence = (msg.at(2) << 8) | msg.at(3);
+        if(!accept_sequence(m_DataSources, addr, msg.at(1), sequence))
+        {
+            m_DuplicatesDropped++;
+            return;
+        }
+
+        std::vector<uint8_t> packet;
+        packet.reserve(msg.size() - SEQUENCE_HEADER_LENGTH);
+        packet.push_back(msg.at(0) & ~PACKET_SEQUENCED_FLAG);
+        packet.insert(packet.end(), msg.begin() + 1 + SEQUENCE_HEADER_LENGTH, msg.end());
+        on_message_received(packet, addr);
+        return;
+    }
+
+    if(msg.at(0) & PACKET_COMPRESSED_FLAG)
+    {
+        std::vector<uint8_t> packet;
+        if(decompress_packet(msg, addr, packet)) {
+            on_message_received(packet, addr);
+        }
+        return;
+    }
+
+    PacketTypes packetType = (PacketTypes)msg.at(0);
+    switch(packetType) {
+        case PacketTypes::DATA:
+            {
+            std::vector<uint8_t> data;
+            for(int i = 1 ; i < msg.size() ; i++) {
+                data.push_back(msg.at(i));
+            }
+            Notify<const std::vector<uint8_t>&>(m_Handlers_Data, data);
+            break;
+        }
+        case PacketTypes::DATA_FRAGMENT:
+        {
+            if(msg.size() < FRAGMENT_HEADER_LENGTH) {
+                break;
+            }
+            uint16_t messageID = (msg.at(1) << 8) | msg.at(2);
+
+            std::vector<uint8_t> data;
+            if(m_Reassembler.AddFragment(addr, messageID, msg.at(3), msg.at(4), msg.data() + FRAGMENT_HEADER_LENGTH, msg.size() - FRAGMENT_HEADER_LENGTH, data)) {
+                Notify<const std::vector<uint8_t>&>(m_Handlers_Data, data);
+            }
+            break;
+        }
+        case PacketTypes::AGGREGATE:
+        {
+            size_t pos = 1;
+            while(pos < msg.size())
+            {
+                size_t length = msg.at(pos);
+                pos++;
+                if(pos + length > msg.size()) {
+                    break;
+                }
+
+                std::vector<uint8_t> data(msg.begin() + pos, msg.begin() + pos + length);
+                Notify<const std::vector<uint8_t>&>(m_Handlers_Data, data);
+                pos += length;
+            }
+            break;
+        }
+        case PacketTypes::RELIABLE_DATA:
+            on_reliable_data(msg, addr);
+            break;
+        case PacketTypes::RELIABLE_ACK:
+            on_reliable_ack(msg, addr);
+            break;
+        case PacketTypes::CAPABILITIES:
+        {
+            bool reply;
+            {
+                std::lock_guard<std::mutex> lock(m_CompressionMutex);
+                m_PeerCodecs[addr] = std::vector<uint8_t>(msg.begin() + 1, msg.end());
+                reply = m_Compressor != NULL && m_AdvertisedTo.insert(addr).second;
+            }
+            if(reply) {
+                send_capabilities(addr);
+            }
+            break;
+        }
+        case PacketTypes::COMPONENT_ITEM_PRESENT:
+        {
+            ResourceKey key;
+            ResourceValue value;
+            if(decode_resource_v1(msg, key, value)) {
+                suppress_reply(key, value);
+                note_remote_resource(addr, key, value, true);
+                onNewRemoteComponentItem(key, value, addr);
+            }
+            break;
+        }
+        case PacketTypes::CONTAINED_VECHILES_REQUEST:
+        {
+            ResourceKey key;
+            int pos = 1;
+
+            //iterate over message pulling every component/value
+            while(pos < msg.size())
+            {
+                std::string element = "";
+                while(msg[pos] != '\0') {
+                    element += msg[pos];
+                    pos++;
+                }
+                pos++;
+
+                key.AddNameToResourceKey(element.c_str());
+            }
+
+            std::vector<std::tuple<ResourceKey, ResourceValue>> contained = RetrieveComponentItems(key, true);
+
+            reply_contained_resources(contained);
+            break;
+        }
+        case PacketTypes::REMOVE_COMPONENT_ITEM:
+        {
+            ResourceKey key;
+            ResourceValue value;
+            if(decode_resource_v1(msg, key, value)) {
+                note_remote_resource(addr, key, value, false);
+                onRemovedRemoteComponentItem(key, value);
+                prune_known_node(addr);
+            }
+            break;
+        }
+        case PacketTypes::COMPONENT_ITEM_PRESENT_V2:
+        case PacketTypes::REMOVE_COMPONENT_ITEM_V2:
+            on_resource_packet_v2(msg, addr);
+            break;
+        case PacketTypes::NAME_DEFINITIONS:
+            on_name_definitions(msg, addr);
+            break;
+        case PacketTypes::NAME_REQUEST:
+            on_name_request(msg, addr);
+            break;
+        case PacketTypes::VERSION_ADVERTISE:
+            on_version_advertise(msg, addr);
+            break;
+        case PacketTypes::SYNC_REQUEST:
+            on_sync_request(msg, addr);
+            break;
+        case PacketTypes::SYNC_COMPLETE:
+            on_sync_complete(msg, addr);
+            break;
+        default:
+            // sent by a newer node, throwing here would unwind through the link's read loop
+            break;
+    }
+}
+
+
+void Interop::send_item_present_message(const ResourceKey &key, const ResourceValue &resource)
+{
+    record_registry_change(true, key, resource);
+    send_resource_messages(PacketTypes::COMPONENT_ITEM_PRESENT, PacketTypes::COMPONENT_ITEM_PRESENT_V2, {std::make_tuple(key, resource)}, BROADCAST_ADDRESS, nullptr);
+}
+
+
+void Interop::send_item_present_messages(const std::vector<std::tuple<ResourceKey, ResourceValue>> &resources)
+{
+    send_resource_messages(PacketTypes::COMPONENT_ITEM_PRESENT, PacketTypes::COMPONENT_ITEM_PRESENT_V2, resources, BROADCAST_ADDRESS, nullptr);
+}
+
+
+void Interop::send_item_remove_message(const ResourceKey &key, const ResourceValue &resource)
+{
+    record_registry_change(false, key, resource);
+    send_resource_messages(PacketTypes::REMOVE_COMPONENT_ITEM, PacketTypes::REMOVE_COMPONENT_ITEM_V2, {std::make_tuple(key, resource)}, BROADCAST_ADDRESS, nullptr);
+}
+
+
+void Interop::reply_contained_resources(const std::vector<std::tuple<ResourceKey, ResourceValue>> &resources)
+{
+    if(resources.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_ReplyMutex);
+        if(m_ResponseSlotMS > 0 && !m_RepliesClosed)
+        {
+            m_PendingReplies.insert(resources.begin(), resources.end());
+
+            // a reply already pending covers this request as well
+            if(m_ReplyTask == 0)
+            {
+                int window = std::min<long long>((long long)m_ResponseSlotMS * (m_KnownNodes.size() + 1), m_MaxResponseDelayMS);
+                int delay = std::uniform_int_distribution<int>(0, std::max(window, 0))(m_ReplyRandom);
+                m_ReplyTask = Scheduler::Instance().Schedule(delay, [this](){
+                    send_pending_replies();
+                });
+            }
+            return;
+        }
+    }
 
-            //iterate over message pulling every component/value
-            while(pos <= msg.size())
+    send_item_present_messages(resources);
+}
+
+
+void Interop::send_pending_replies()
+{
+    std::vector<std::tuple<ResourceKey, ResourceValue>> resources;
+    {
+        std::lock_guard<std::mutex> lock(m_ReplyMutex);
+        m_ReplyTask = 0;
+        if(m_RepliesClosed) {
+            return;
+        }
+        resources.assign(m_PendingReplies.begin(), m_PendingReplies.end());
+        m_PendingReplies.clear();
+    }
+
+    if(resources.empty() == false) {
+        send_item_present_messages(resources);
+    }
+}
+
+
+void Interop::suppress_reply(const ResourceKey &key, const ResourceValue &resource)
+{
+    std::lock_guard<std::mutex> lock(m_ReplyMutex);
+    m_PendingReplies.erase(std::make_tuple(key, resource));
+}
+
+
+void Interop::send_resource_messages(PacketTypes legacyType, PacketTypes compactType, const std::vector<std::tuple<ResourceKey, ResourceValue>> &resources, uint64_t addr, const std::function<void(const TransmitStatusTypes &)> &cb)
+{
+    for(auto it = resources.cbegin() ; it != resources.cend() ; ++it)
+    {
+        if(std::get<0>(*it).size() != std::get<1>(*it).size())
+        {
+            throw std::runtime_error("given resource key and resource value don't match in size!");
+        }
+    }
+
+    size_t maxPayload = *m_MaxPayload;
+
+    std::vector<std::vector<uint8_t>> packets;
+    std::vector<uint32_t> newNames;
+    {
+        std::lock_guard<std::mutex> lock(m_NameMutex);
+        for(auto it = resources.cbegin() ; it != resources.cend() ; ++it)
+        {
+            if(m_LegacyResourceEncoding)
             {
-                std::string element = "";
-                int pos = 1;
-                while(msg[pos] != '\0') {
-                    element += msg[pos];
-                    pos++;
-                }
-                int ID = 0;
-                for(int i = 0 ; i < 4 ; i++) {
-                    ID |= (((uint64_t)msg[pos+1+i]) << (8*(3-i)));
-                }
-                pos += 4;
+                packets.push_back(std::vector<uint8_t>());
+                packets.back().push_back((uint8_t)legacyType);
+                encode_resource_v1(std::get<0>(*it), std::get<1>(*it), packets.back());
+                continue;
+            }
 
-                key.AddNameToResourceKey(element.c_str());
-                value.AddValueToResourceKey(ID);
+            std::vector<uint8_t> entry;
+            encode_resource_v2(std::get<0>(*it), std::get<1>(*it), entry, newNames);
+
+            // an entry too large to share a packet still goes out alone
+            if(packets.empty() || packets.back().size() + entry.size() > maxPayload)
+            {
+                packets.push_back(std::vector<uint8_t>());
+                packets.back().reserve(maxPayload);
+                packets.back().push_back((uint8_t)compactType);
+                packets.back().push_back(m_NameEpoch);
             }
+            packets.back().insert(packets.back().end(), entry.begin(), entry.end());
+        }
+    }
 
-            onRemovedRemoteComponentItem(key, value);
-            break;
+    // queued ahead of the packets using them, so receivers usually know the names by the time they arrive
+    if(newNames.empty() == false) {
+        send_name_definitions(addr, newNames);
+    }
+
+    if(!cb)
+    {
+        for(size_t i = 0 ; i < packets.size() ; i++) {
+            ((DigiMeshRadio*)m_Radio)->SendMessage(packets.at(i), addr);
         }
-        default:
-            throw std::runtime_error("Unknown packet type received over digimesh network");
+        return;
+    }
+
+    if(packets.empty())
+    {
+        cb(TransmitStatusTypes::SUCCESS);
+        return;
+    }
+
+    std::function<void(const TransmitStatusTypes &)> combined = make_combined_status(packets.size(), cb);
+    for(size_t i = 0 ; i < packets.size() ; i++)
+    {
+        ((DigiMeshRadio*)m_Radio)->SendMessage(packets.at(i), addr, [combined](const ATData::TransmitStatus &status){
+            combined(status.status);
+        });
     }
 }
 
 
-void Interop::send_item_present_message(const ResourceKey &key, const ResourceValue &resource)
+void Interop::record_registry_change(bool present, const ResourceKey &key, const ResourceValue &resource)
 {
-    if(key.size() != resource.size())
-    {
-        throw std::runtime_error("given resource key and resource value don't match in size!");
+    std::lock_guard<std::mutex> lock(m_RegistryMutex);
+    m_RegistryVersion++;
+
+    RegistryChange change;
+    change.version = m_RegistryVersion;
+    change.present = present;
+    change.key = key;
+    change.value = resource;
+    m_RegistryLog.push_back(change);
+    if(m_RegistryLog.size() > REGISTRY_LOG_LENGTH) {
+        m_RegistryLog.pop_front();
     }
+}
 
 
+void Interop::send_version(PacketTypes type, uint64_t addr)
+{
     std::vector<uint8_t> packet;
-    packet.push_back((uint8_t)PacketTypes::COMPONENT_ITEM_PRESENT);
+    packet.push_back((uint8_t)type);
+    {
+        std::lock_guard<std::mutex> lock(m_RegistryMutex);
+        packet.push_back(m_RegistryEpoch);
+        write_varint(packet, m_RegistryVersion);
+    }
 
-    for(int i = 0 ; i < key.size() ; i++) {
+    // if dropped, the next advertisement or sync request tries again
+    send_packet_nothrow(addr, packet);
+}
 
-        std::string componentName = key.at(i);
-        int ID = resource.at(i);
 
-        size_t pos = 0;
-        do
+void Interop::on_version_advertise(const std::vector<uint8_t> &msg, uint64_t addr)
+{
+    size_t pos = 2;
+    uint32_t version;
+    if(msg.size() < 2 || !read_varint(msg, pos, version)) {
+        return;
+    }
+
+    // the node heartbeats from now on, so it can be held to a lease
+    if(m_LeaseMS > 0 && m_Leases.find(addr) == m_Leases.end()) {
+        m_Leases.insert(std::make_pair(addr, std::chrono::steady_clock::now()));
+    }
+
+    std::vector<uint8_t> request;
+    request.push_back((uint8_t)PacketTypes::SYNC_REQUEST);
+
+    auto it = m_PeerVersions.find(addr);
+    if(it != m_PeerVersions.end() && it->second.epoch == msg.at(1))
+    {
+        if(it->second.version == version) {
+            return;
+        }
+        request.push_back(it->second.epoch);
+        write_varint(request, it->second.version);
+    }
+    // otherwise nothing is known of the node's current run, ask for everything
+
+    // the answer may be a snapshot even to a request for changes, so what the node announces is noted either way
+    auto sync = m_Syncs.find(addr);
+    if(sync == m_Syncs.end() || sync->second.epoch != msg.at(1))
+    {
+        SyncInProgress progress;
+        progress.epoch = msg.at(1);
+        m_Syncs[addr] = progress;
+    }
+
+    // if dropped, the next advertisement asks again
+    send_packet_nothrow(addr, request);
+}
+
+
+void Interop::on_sync_request(const std::vector<uint8_t> &msg, uint64_t addr)
+{
+    size_t pos = 2;
+    uint32_t since = 0;
+    bool delta = msg.size() >= 2 && read_varint(msg, pos, since);
+
+    std::vector<std::tuple<ResourceKey, ResourceValue>> present;
+    std::vector<std::tuple<ResourceKey, ResourceValue>> removed;
+    uint32_t version;
+    {
+        std::lock_guard<std::mutex> lock(m_RegistryMutex);
+        version = m_RegistryVersion;
+
+        // the log has to hold every change after since, versions wrap so distances are compared
+        if(delta && (msg.at(1) != m_RegistryEpoch || (int32_t)(version - since) < 0)) {
+            delta = false;
+        }
+        if(delta && since != version && (m_RegistryLog.empty() || (int32_t)(m_RegistryLog.front().version - 1 - since) > 0)) {
+            delta = false;
+        }
+
+        if(delta)
         {
-            packet.push_back(componentName[pos]);
-            pos++;
+            // only the last change to each resource matters
+            std::map<std::tuple<ResourceKey, ResourceValue>, bool> latest;
+            for(auto it = m_RegistryLog.cbegin() ; it != m_RegistryLog.cend() ; ++it) {
+                if((int32_t)(it->version - since) > 0) {
+                    latest[std::make_tuple(it->key, it->value)] = it->present;
+                }
+            }
+            for(auto it = latest.cbegin() ; it != latest.cend() ; ++it) {
+                (it->second ? present : removed).push_back(it->first);
+            }
         }
-        while(componentName[pos] != '\0');
-        packet.push_back('\0');
+    }
 
-        for(size_t i = 0 ; i < 4 ; i++) {
-            uint64_t a = (ID & (0xFFll << (8*(3-i)))) >> (8*(3-i));
-            packet.push_back((char)a);
+    // changes after the version captured above are covered by the next request, applying one twice is harmless
+    if(!delta) {
+        present = RetrieveComponentItems(ResourceKey(), true);
+    }
+
+    uint8_t epoch = m_RegistryEpoch;
+    bool snapshot = !delta;
+    std::function<void(const TransmitStatusTypes &)> complete = [this, addr, epoch, version, snapshot](const TransmitStatusTypes &status){
+        if(status != TransmitStatusTypes::SUCCESS) {
+            // the requester asks again on the next advertisement
+            return;
         }
+
+        std::vector<uint8_t> packet;
+        packet.push_back((uint8_t)PacketTypes::SYNC_COMPLETE);
+        packet.push_back(epoch);
+        write_varint(packet, version);
+        packet.push_back(snapshot ? 1 : 0);
+
+        send_packet_nothrow(addr, packet);
+    };
+
+    if(removed.empty())
+    {
+        send_resource_messages(PacketTypes::COMPONENT_ITEM_PRESENT, PacketTypes::COMPONENT_ITEM_PRESENT_V2, present, addr, complete);
+        return;
     }
-    ((DigiMeshRadio*)m_Radio)->SendMessage(packet);
+
+    std::function<void(const TransmitStatusTypes &)> part = make_combined_status(2, complete);
+    send_resource_messages(PacketTypes::COMPONENT_ITEM_PRESENT, PacketTypes::COMPONENT_ITEM_PRESENT_V2, present, addr, part);
+    send_resource_messages(PacketTypes::REMOVE_COMPONENT_ITEM, PacketTypes::REMOVE_COMPONENT_ITEM_V2, removed, addr, part);
 }
 
 
-void Interop::send_item_remove_message(const ResourceKey &key, const ResourceValue &resource)
+void Interop::on_sync_complete(const std::vector<uint8_t> &msg, uint64_t addr)
 {
-    std::vector<uint8_t> packet;
-    packet.push_back((uint8_t)PacketTypes::REMOVE_COMPONENT_ITEM);
+    size_t pos = 2;
+    uint32_t version;
+    if(msg.size() < 2 || !read_varint(msg, pos, version)) {
+        return;
+    }
+
+    bool snapshot = pos < msg.size() && msg.at(pos) != 0;
+
+    // a packet of the answer is still waiting on name definitions, the next advertisement asks again
+    auto names = m_PeerNames.find(addr);
+    if(names != m_PeerNames.end() && names->second.pending.empty() == false) {
+        return;
+    }
+
+    auto sync = m_Syncs.find(addr);
+    if(snapshot && sync != m_Syncs.end() && sync->second.epoch == msg.at(1))
+    {
+        // anything not in the snapshot is left over from before, such as a previous run of the node
+        std::vector<std::tuple<ResourceKey, ResourceValue>> held = RetrieveRemoteComponentItems(addr);
+        for(auto it = held.cbegin() ; it != held.cend() ; ++it) {
+            if(sync->second.heard.find(*it) == sync->second.heard.end()) {
+                onRemovedRemoteComponentItem(std::get<0>(*it), std::get<1>(*it));
+            }
+        }
+        prune_known_node(addr);
+    }
+    if(sync != m_Syncs.end()) {
+        m_Syncs.erase(sync);
+    }
 
-    if(key.size() != resource.size())
+    auto it = m_PeerVersions.find(addr);
+    if(it == m_PeerVersions.end() || it->second.epoch != msg.at(1))
+    {
+        PeerVersion peer;
+        peer.epoch = msg.at(1);
+        peer.version = version;
+        m_PeerVersions[addr] = peer;
+    }
+    else if((int32_t)(version - it->second.version) > 0)
     {
-        throw std::runtime_error("given resource key and resource value don't match in size!");
+        // answers to overlapping requests may arrive out of order, never move backwards
+        it->second.version = version;
     }
+}
 
+
+void Interop::encode_resource_v1(const ResourceKey &key, const ResourceValue &resource, std::vector<uint8_t> &packet)
+{
     for(int i = 0 ; i < key.size() ; i++) {
 
         std::string componentName = key.at(i);
         int ID = resource.at(i);
 
-        size_t pos = 0;
-        do
-        {
-            packet.push_back(componentName[pos]);
-            pos++;
-        }
-        while(componentName[pos] != '\0');
+        packet.insert(packet.end(), componentName.begin(), componentName.end());
         packet.push_back('\0');
 
         for(size_t i = 0 ; i < 4 ; i++) {
             uint64_t a = (ID & (0xFFll << (8*(3-i)))) >> (8*(3-i));
             packet.push_back((char)a);
         }
+    }
+}
+
+
+void Interop::encode_resource_v2(const ResourceKey &key, const ResourceValue &resource, std::vector<uint8_t> &packet, std::vector<uint32_t> &newNames)
+{
+    write_varint(packet, key.size());
+    for(int i = 0 ; i < key.size() ; i++)
+    {
+        uint32_t nameID;
+        std::map<std::string, uint32_t>::const_iterator it = m_NameIDs.find(key.at(i));
+        if(it == m_NameIDs.end())
+        {
+            nameID = m_Names.size();
+            m_Names.push_back(key.at(i));
+            m_NameIDs.insert(std::make_pair(key.at(i), nameID));
+            newNames.push_back(nameID);
+        }
+        else
+        {
+            nameID = it->second;
+        }
 
+        write_varint(packet, nameID);
+        write_varint(packet, zigzag_encode(resource.at(i)));
     }
+}
 
-    ((DigiMeshRadio*)m_Radio)->SendMessage(packet);
+
+void Interop::send_name_definitions(uint64_t addr, const std::vector<uint32_t> &nameIDs)
+{
+    size_t maxPayload = *m_MaxPayload;
+
+    std::vector<std::vector<uint8_t>> packets;
+    {
+        std::lock_guard<std::mutex> lock(m_NameMutex);
+        for(size_t i = 0 ; i < nameIDs.size() ; i++)
+        {
+            if(nameIDs.at(i) >= m_Names.size()) {
+                continue;
+            }
+            const std::string &name = m_Names.at(nameIDs.at(i));
+
+            std::vector<uint8_t> definition;
+            write_varint(definition, nameIDs.at(i));
+            definition.insert(definition.end(), name.begin(), name.end());
+            definition.push_back('\0');
+
+            if(packets.empty() || packets.back().size() + definition.size() > maxPayload)
+            {
+                packets.push_back(std::vector<uint8_t>());
+                packets.back().push_back((uint8_t)PacketTypes::NAME_DEFINITIONS);
+                packets.back().push_back(m_NameEpoch);
+            }
+            packets.back().insert(packets.back().end(), definition.begin(), definition.end());
+        }
+    }
+
+    // a receiver missing a definition asks for it again
+    for(size_t i = 0 ; i < packets.size() ; i++) {
+        if(!send_packet_nothrow(addr, packets.at(i))) {
+            break;
+        }
+    }
+}
+
+
+void Interop::on_resource_packet_v2(const std::vector<uint8_t> &msg, uint64_t addr)
+{
+    if(msg.size() < 2) {
+        return;
+    }
+    PeerNames &peer = peer_names(addr, msg.at(1));
+
+    std::vector<std::tuple<ResourceKey, ResourceValue>> resources;
+    std::set<uint32_t> missing;
+    size_t pos = 2;
+    while(pos < msg.size())
+    {
+        ResourceKey key;
+        ResourceValue value;
+        if(!decode_resource_v2(msg, pos, peer.names, key, value, missing)) {
+            return;
+        }
+        resources.push_back(std::make_tuple(key, value));
+    }
+
+    if(missing.empty() == false)
+    {
+        // the definitions were lost or this node joined after they were broadcast, ask the sender again
+        if(peer.pending.size() >= MAX_PENDING_NAMED_PACKETS) {
+            peer.pending.erase(peer.pending.begin());
+        }
+        peer.pending.push_back(msg);
+
+        std::vector<uint8_t> request;
+        request.push_back((uint8_t)PacketTypes::NAME_REQUEST);
+        request.push_back(msg.at(1));
+        for(auto it = missing.cbegin() ; it != missing.cend() ; ++it) {
+            write_varint(request, *it);
+        }
+
+        // if dropped, the next packet using the names asks again
+        send_packet_nothrow(addr, request);
+        return;
+    }
+
+    for(auto it = resources.cbegin() ; it != resources.cend() ; ++it)
+    {
+        if((PacketTypes)msg.at(0) == PacketTypes::COMPONENT_ITEM_PRESENT_V2) {
+            suppress_reply(std::get<0>(*it), std::get<1>(*it));
+            note_remote_resource(addr, std::get<0>(*it), std::get<1>(*it), true);
+            onNewRemoteComponentItem(std::get<0>(*it), std::get<1>(*it), addr);
+        }
+        else {
+            note_remote_resource(addr, std::get<0>(*it), std::get<1>(*it), false);
+            onRemovedRemoteComponentItem(std::get<0>(*it), std::get<1>(*it));
+        }
+    }
+
+    if((PacketTypes)msg.at(0) == PacketTypes::REMOVE_COMPONENT_ITEM_V2) {
+        prune_known_node(addr);
+    }
+}
+
+
+void Interop::on_name_definitions(const std::vector<uint8_t> &msg, uint64_t addr)
+{
+    if(msg.size() < 2) {
+        return;
+    }
+    PeerNames &peer = peer_names(addr, msg.at(1));
+
+    size_t pos = 2;
+    while(pos < msg.size())
+    {
+        uint32_t nameID;
+        if(!read_varint(msg, pos, nameID)) {
+            break;
+        }
+
+        std::string name = "";
+        while(pos < msg.size() && msg[pos] != '\0') {
+            name += msg[pos];
+            pos++;
+        }
+        if(pos >= msg.size()) {
+            break;
+        }
+        pos++;
+
+        peer.names[nameID] = name;
+    }
+
+    // packets still missing names are held and requested again
+    std::vector<std::vector<uint8_t>> pending;
+    pending.swap(peer.pending);
+    for(size_t i = 0 ; i < pending.size() ; i++) {
+        on_resource_packet_v2(pending.at(i), addr);
+    }
+}
+
+
+void Interop::on_name_request(const std::vector<uint8_t> &msg, uint64_t addr)
+{
+    if(msg.size() < 2) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_NameMutex);
+        if(msg.at(1) != m_NameEpoch) {
+            // asked about names of a previous run, which are gone
+            return;
+        }
+    }
+
+    std::vector<uint32_t> nameIDs;
+    size_t pos = 2;
+    uint32_t nameID;
+    while(pos < msg.size() && read_varint(msg, pos, nameID)) {
+        nameIDs.push_back(nameID);
+    }
+
+    send_name_definitions(addr, nameIDs);
+}
+
+
+Interop::PeerNames& Interop::peer_names(uint64_t addr, uint8_t epoch)
+{
+    auto it = m_PeerNames.find(addr);
+    if(it == m_PeerNames.end())
+    {
+        it = m_PeerNames.insert(std::make_pair(addr, PeerNames())).first;
+        it->second.epoch = epoch;
+    }
+    else if(it->second.epoch != epoch)
+    {
+        // the sender restarted and numbered its names afresh
+        it->second.epoch = epoch;
+        it->second.names.clear();
+        it->second.pending.clear();
+    }
+    return it->second;
+}
+
+
+void Interop::note_remote_resource(uint64_t addr, const ResourceKey &key, const ResourceValue &resource, bool present)
+{
+    if(present) {
+        m_KnownNodes.insert(addr);
+    }
+
+    auto sync = m_Syncs.find(addr);
+    if(sync == m_Syncs.end()) {
+        return;
+    }
+
+    if(present) {
+        sync->second.heard.insert(std::make_tuple(key, resource));
+    }
+    else {
+        sync->second.heard.erase(std::make_tuple(key, resource));
+    }
+}
+
+
+void Interop::prune_known_node(uint64_t addr)
+{
+    if(RetrieveRemoteComponentItems(addr).empty()) {
+        m_KnownNodes.erase(addr);
+    }
+}
+
+
+void Interop::renew_lease(uint64_t addr)
+{
+    auto it = m_Leases.find(addr);
+    if(it != m_Leases.end()) {
+        it->second = std::chrono::steady_clock::now();
+    }
+}
+
+
+void Interop::check_leases()
+{
+    // resource callbacks all run on the radio's thread, expiring a node's resources is no different
+    std::shared_ptr<LeaseGuard> guard = m_LeaseGuard;
+    ((DigiMeshRadio*)m_Radio)->RunOnLinkThread([guard](){
+        std::lock_guard<std::mutex> lock(guard->mutex);
+        if(guard->owner != NULL) {
+            guard->owner->expire_leases();
+        }
+    });
+}
+
+
+void Interop::expire_leases()
+{
+    int leaseMS = m_LeaseMS;
+    if(leaseMS <= 0)
+    {
+        m_Leases.clear();
+        return;
+    }
+
+    std::vector<uint64_t> expired;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for(auto it = m_Leases.begin() ; it != m_Leases.end() ; )
+    {
+        if(now - it->second > std::chrono::milliseconds(leaseMS))
+        {
+            expired.push_back(it->first);
+            it = m_Leases.erase(it);
+            continue;
+        }
+        ++it;
+    }
+
+    for(size_t i = 0 ; i < expired.size() ; i++)
+    {
+        // a returning node's next advertisement asks for all of its resources again
+        m_PeerVersions.erase(expired.at(i));
+        m_Syncs.erase(expired.at(i));
+        m_KnownNodes.erase(expired.at(i));
+
+        std::vector<std::tuple<ResourceKey, ResourceValue>> resources = RetrieveRemoteComponentItems(expired.at(i));
+        for(auto it = resources.cbegin() ; it != resources.cend() ; ++it) {
+            onRemovedRemoteComponentItem(std::get<0>(*it), std::get<1>(*it));
+        }
+    }
 }
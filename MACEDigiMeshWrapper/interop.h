@@ -4,13 +4,40 @@
 #include <vector>
 #include <functional>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <map>
+#include <set>
+#include <deque>
+#include <tuple>
+#include <random>
+#include <chrono>
 
 #include "digi_mesh_baud_rates.h"
 #include "transmit_status_types.h"
+#include "transmit_priority.h"
+#include "transmit_options.h"
+#include "route_information.h"
 #include "resource.h"
+#include "fragment_reassembler.h"
+#include "scheduler.h"
+#include "i_compressor.h"
+#include "reliable_sender.h"
+#include "sequence_window.h"
 
 #include "macewrapper_global.h"
 
+#define DEFAULT_AGGREGATION_DELAY_MS 50
+#define DEFAULT_RESPONSE_SLOT_MS 25
+#define DEFAULT_MAX_RESPONSE_DELAY_MS 2000
+#define DEFAULT_SYNC_INTERVAL_MS 30000
+// changes to this node's resources kept to answer delta sync requests, older ones are answered with a snapshot
+#define REGISTRY_LOG_LENGTH 64
+// a little over three advertisement intervals, so a single lost advertisement doesn't expire a node
+#define DEFAULT_LEASE_MS 100000
+// lease checks per lease, bounding how late past its lease a node is expired
+#define LEASE_CHECKS 4
+
 
 
 
@@ -33,6 +60,62 @@
  * Remove Entity (N+5) - Signal that a vehicle attached to a node is no longer
  *      0x04 | Name0 | Name1 | ... | NameN | '\0' | ID byte 1 (MSB) | ID byte 2 | ID byte 3 | ID byte 1 (LSB)
  *
+ * Data Fragment (N+5) - Piece of a byte array too large for the radio's maximum payload (NP)
+ *      0x05 | Message ID (MSB) | Message ID (LSB) | Fragment Index | Fragment Count | <data1> | ... | <dataN>
+ *
+ * Aggregate (N+1) - Several byte arrays bound for the same destination, each prefixed with its length
+ *      0x06 | Length1 | <data1> | ... | LengthM | <dataM>
+ *
+ * Capabilities (N+1) - IDs of the compression codecs the sending node can decode
+ *      0x07 | Codec ID 1 | ... | Codec ID N
+ *
+ * Reliable Data (N+4) - Byte array the receiver acknowledges, resent until it is
+ *      0x08 | Session | Sequence (MSB) | Sequence (LSB) | <data1> | ... | <dataN>
+ *
+ * Reliable Ack (8) - Next sequence number expected from the session, and which of the 32 after it were received
+ *      0x09 | Session | Expected (MSB) | Expected (LSB) | Selective byte 1 (MSB) | ... | Selective byte 4 (LSB)
+ *
+ * Entity Present v2 / Remove Entity v2 - Compact forms of 0x02 and 0x04, names are replaced by the sender's name IDs
+ * and a packet carries as many entries as fit in the radio's maximum payload
+ *      0x0A / 0x0B | Name Epoch | Entry 1 | ... | Entry M
+ *      Entry: Pair Count | Name ID 1 | ID 1 | ... | Name ID N | ID N
+ *
+ * Name Definitions - Name IDs the sender uses in v2 packets, broadcast when first used and sent on request
+ *      0x0C | Name Epoch | Name ID 1 | Name1 | '\0' | ... | Name ID N | NameN | '\0'
+ *
+ * Name Request - Name IDs the receiver of a v2 packet could not resolve, sent back to its sender
+ *      0x0D | Name Epoch | Name ID 1 | ... | Name ID N
+ *
+ * Counts and name IDs in v2 packets are unsigned LEB128 varints, IDs are zigzag encoded varints. A sender picks a
+ * random name epoch each run, a receiver forgets a sender's names when its epoch changes.
+ *
+ * Version Advertise - Version of the sender's resources, bumped each time one is added or removed, broadcast
+ * periodically
+ *      0x0E | Registry Epoch | Version
+ *
+ * Sync Request - Ask a node for the changes to its resources after the given version, or for all of them if the epoch
+ * and version are left out. The node answers with resource packets sent to the requester, followed by a Sync Complete
+ *      0x0F [ | Registry Epoch | Version ]
+ *
+ * Sync Complete - Version the requester is now in sync with, sent once every packet of the answer was delivered.
+ * Snapshot is 1 if the answer held every resource of the node, the requester then removes any others it holds for it
+ *      0x10 | Registry Epoch | Version | Snapshot
+ *
+ * Versions are unsigned LEB128 varints. A node picks a random registry epoch each run and starts its version at 0.
+ * Nodes that predate these packets ignore or throw on them, so advertising is off unless enabled.
+ *
+ * Once leases are enabled, a node that has advertised its version holds its resources on a lease, renewed by every
+ * packet heard from it. The advertisement is the heartbeat, one packet renewing all of the node's resources. If the
+ * lease passes, the node's resources are removed as though it had sent a Remove Entity for each.
+ *
+ * DATA, DATA_FRAGMENT, AGGREGATE and RELIABLE_DATA packets unicast to a peer that advertised this node's codec may be
+ * compressed. The high bit of the type byte (0x80) is then set and everything following the type byte is compressed.
+ *
+ * DATA, DATA_FRAGMENT and AGGREGATE packets may carry a sequence header, so receivers can drop repeated copies. Bit
+ * 0x40 of the type byte is then set and the header follows the type byte, ahead of any compressed body:
+ *      Type | Session | Sequence (MSB) | Sequence (LSB) | ...
+ * Packet types stay below 0x40 to leave both flag bits free.
+ *
  */
 class Interop
 {
@@ -44,17 +127,176 @@ private:
         DATA = 0x01,
         COMPONENT_ITEM_PRESENT = 0x02,
         CONTAINED_VECHILES_REQUEST = 0x03,
-        REMOVE_COMPONENT_ITEM = 0x04
+        REMOVE_COMPONENT_ITEM = 0x04,
+        DATA_FRAGMENT = 0x05,
+        AGGREGATE = 0x06,
+        CAPABILITIES = 0x07,
+        RELIABLE_DATA = 0x08,
+        RELIABLE_ACK = 0x09,
+        COMPONENT_ITEM_PRESENT_V2 = 0x0A,
+        REMOVE_COMPONENT_ITEM_V2 = 0x0B,
+        NAME_DEFINITIONS = 0x0C,
+        NAME_REQUEST = 0x0D,
+        VERSION_ADVERTISE = 0x0E,
+        SYNC_REQUEST = 0x0F,
+        SYNC_COMPLETE = 0x10
+    };
+
+    struct PendingAggregate
+    {
+        std::vector<uint8_t> packet;
+        std::vector<std::function<void(const TransmitStatusTypes &)>> callbacks;
+        Scheduler::TaskID flushTask;
+
+        PendingAggregate() :
+            flushTask(0)
+        {
+        }
+    };
+
+    struct ReliablePeer
+    {
+        ReliableSender sender;
+        Scheduler::TaskID retransmitTask;
+
+        ReliablePeer() :
+            retransmitTask(0)
+        {
+        }
+    };
+
+    struct SenderWindow
+    {
+        uint8_t session;
+        SequenceWindow window;
+    };
+
+    struct PeerNames
+    {
+        uint8_t epoch;
+        std::map<uint32_t, std::string> names;
+        // v2 packets waiting on definitions of names they use
+        std::vector<std::vector<uint8_t>> pending;
+    };
+
+    struct RegistryChange
+    {
+        uint32_t version;
+        bool present;
+        ResourceKey key;
+        ResourceValue value;
+    };
+
+    struct PeerVersion
+    {
+        uint8_t epoch;
+        uint32_t version;
+    };
+
+    struct SyncInProgress
+    {
+        uint8_t epoch;
+        // resources heard from the node since the request, the ones a snapshot answer leaves it holding
+        std::set<std::tuple<ResourceKey, ResourceValue>> heard;
+    };
+
+    /**
+     * @brief Lets lease checks handed to the radio's thread find out whether this object still exists
+     */
+    struct LeaseGuard
+    {
+        std::mutex mutex;
+        Interop *owner;
     };
 
     static const char NI_NAME_VEHICLE_DELIMETER = '|';
 
     void* m_Radio;
 
-    std::mutex m_NIMutex;
-
     std::vector<std::function<void(const std::vector<uint8_t>&)>> m_Handlers_Data;
 
+    // shared with the pending NP query, which may answer after this object is gone
+    std::shared_ptr<std::atomic<size_t>> m_MaxPayload;
+    std::atomic<uint16_t> m_NextMessageID;
+
+    // fragments only arrive on the radio's thread
+    FragmentReassembler m_Reassembler;
+
+    // DATA messages held per destination until the frame is full or the flush delay passes
+    bool m_Aggregate;
+    int m_AggregationDelayMS;
+    std::map<uint64_t, PendingAggregate> m_Aggregates;
+    std::mutex m_AggregationMutex;
+
+    // codec in use, and what has been exchanged with each peer about codecs
+    std::shared_ptr<ICompressor> m_Compressor;
+    std::map<uint64_t, std::vector<uint8_t>> m_PeerCodecs;
+    std::set<uint64_t> m_AdvertisedTo;
+    std::mutex m_CompressionMutex;
+
+    // reliable messages awaiting acknowledgement, per destination
+    std::map<uint64_t, ReliablePeer> m_ReliablePeers;
+    bool m_ReliableClosed;
+    std::mutex m_ReliableMutex;
+
+    // reliable messages received, per sender, only touched on the radio's thread
+    std::map<uint64_t, SenderWindow> m_ReliableSources;
+
+    // sequence headers stamped on outgoing DATA path packets, and those seen from each sender on the radio's thread
+    std::atomic<bool> m_SequenceData;
+    uint8_t m_Session;
+    std::atomic<uint16_t> m_NextSequence;
+    std::map<uint64_t, SenderWindow> m_DataSources;
+    std::atomic<size_t> m_DuplicatesDropped;
+
+    // name IDs this node uses in v2 resource packets
+    bool m_LegacyResourceEncoding;
+    uint8_t m_NameEpoch;
+    std::map<std::string, uint32_t> m_NameIDs;
+    std::vector<std::string> m_Names;
+    std::mutex m_NameMutex;
+
+    // name IDs used by each sender, only touched on the radio's thread
+    std::map<uint64_t, PeerNames> m_PeerNames;
+
+    // nodes holding resources, the ones that answer contained resource requests, only touched on the radio's thread
+    std::set<uint64_t> m_KnownNodes;
+
+    // items waiting on the jittered reply to contained resource requests
+    int m_ResponseSlotMS;
+    int m_MaxResponseDelayMS;
+    std::set<std::tuple<ResourceKey, ResourceValue>> m_PendingReplies;
+    Scheduler::TaskID m_ReplyTask;
+    bool m_RepliesClosed;
+    std::mt19937 m_ReplyRandom;
+    std::mutex m_ReplyMutex;
+
+    // version of this node's resources and the latest changes to them
+    uint8_t m_RegistryEpoch;
+    uint32_t m_RegistryVersion;
+    std::deque<RegistryChange> m_RegistryLog;
+    std::mutex m_RegistryMutex;
+
+    // periodic version advertisement
+    int m_SyncIntervalMS;
+    Scheduler::TaskID m_AdvertiseTask;
+    bool m_SyncClosed;
+    std::mutex m_SyncMutex;
+
+    // version each node's resources are known at, and the sync requests outstanding, only touched on the radio's
+    // thread
+    std::map<uint64_t, PeerVersion> m_PeerVersions;
+    std::map<uint64_t, SyncInProgress> m_Syncs;
+
+    // time each advertising node was last heard from, only touched on the radio's thread, where a periodic check
+    // expires nodes that have gone silent
+    std::atomic<int> m_LeaseMS;
+    std::map<uint64_t, std::chrono::steady_clock::time_point> m_Leases;
+    std::shared_ptr<LeaseGuard> m_LeaseGuard;
+    Scheduler::TaskID m_LeaseTask;
+    bool m_LeaseClosed;
+    std::mutex m_LeaseMutex;
+
     std::string m_NodeName;
 
 public:
@@ -80,17 +322,138 @@ public:
     void AddHandler_Data(const std::function<void (const std::vector<uint8_t> &)> &lambda);
 
 
+    /**
+     * @brief Add handler to be called with every hop reported for data sent with TransmitOptions::traceRoute
+     *
+     * Hops carry no message id, their destination address tells which send they belong to. The radio also reports
+     * route repairs after a hop failed to acknowledge, those are passed with RouteInformationEvents::NACK.
+     * @param lambda Lambda function accepting the reported hop, called on the link thread
+     */
+    void AddHandler_RouteInformation(const std::function<void (const RouteInformation &)> &lambda);
+
+
     /**
      * @brief Broadcast data to all nodes
      * @param data Data to broadcast out
+     * @param priority [TELEMETRY] Class the data is queued in
+     * @param options [TransmitOptions()] Transmit options, set broadcastRadius to limit how many hops the data travels
+     */
+    void BroadcastData(const std::vector<uint8_t> &data, TransmitPriority priority = TransmitPriority::TELEMETRY, const TransmitOptions &options = TransmitOptions());
+
+
+    /**
+     * @brief Pack small DATA messages bound for the same destination into shared frames
+     *
+     * A destination's messages are held until the next one would not fit in the radio's maximum payload, or until
+     * the flush delay after the first of them passes. Only TransmitPriority::TELEMETRY messages sent with default
+     * TransmitOptions are aggregated.
+     * @param enabled True to aggregate, false sends every message in its own frame
+     * @param flushDelayMS [DEFAULT_AGGREGATION_DELAY_MS] Longest a message is held
+     */
+    void SetAggregation(bool enabled, int flushDelayMS = DEFAULT_AGGREGATION_DELAY_MS);
+
+
+    /**
+     * @brief Compress DATA packets sent to peers that advertise the same codec
+     *
+     * This node's codec is advertised to each peer the first time data is sent to it, and in reply to a peer's
+     * advertisement. Packets are only compressed when that makes them smaller.
+     * @param compressor Codec to use, NULL disables compression
+     */
+    void SetCompressor(const std::shared_ptr<ICompressor> &compressor);
+
+
+    /**
+     * @brief Stamp DATA path packets with a sequence header, so receivers drop repeated copies before handling them
+     *
+     * Disabled by default, nodes that predate the header can't decode stamped packets. Headers are always
+     * understood on reception, enable stamping once every node on the network does.
+     * @param enabled True to stamp packets
+     */
+    void SetSequenceNumbering(bool enabled);
+
+
+    /**
+     * @brief Number of repeated DATA path packets dropped on reception
+     */
+    size_t DuplicatesDropped() const;
+
+
+    /**
+     * @brief Announce and remove resources in the original format, spelling out every name
+     *
+     * The original format is used by default, nodes that predate the compact v2 format can't decode it. Both formats
+     * are always understood on reception, switch to v2 once every node on the network does.
+     * The original format carries a single resource per packet, so only v2 batches the replies to contained resource
+     * requests, packing as many resources into each packet as the radio's payload allows.
+     * @param legacy True to send the original format, false the compact v2 format
+     */
+    void SetLegacyResourceEncoding(bool legacy);
+
+
+    /**
+     * @brief Spread replies to contained resource requests over a random delay, so nodes don't all answer at once
+     *
+     * The delay is drawn uniformly up to slotMS for every node known to hold resources, including this one, capped
+     * at maxDelayMS.
+     * Items another node announces while this node's reply is pending, or that are requested again, are only sent
+     * once.
+     * @param slotMS [DEFAULT_RESPONSE_SLOT_MS] Delay allowed per node, 0 replies straight away
+     * @param maxDelayMS [DEFAULT_MAX_RESPONSE_DELAY_MS] Longest delay
+     */
+    void SetResponseJitter(int slotMS = DEFAULT_RESPONSE_SLOT_MS, int maxDelayMS = DEFAULT_MAX_RESPONSE_DELAY_MS);
+
+
+    /**
+     * @brief Set how often this node broadcasts the version of its resources
+     *
+     * A node hearing a version it doesn't hold asks for the changes since the version it does, or for every resource
+     * if it holds none from the advertiser's current run, so keeping in sync costs a few bytes per interval when
+     * nothing changes. Advertising is off by default, nodes that predate versioning can't decode the advertisement.
+     * Every node answers sync requests regardless.
+     * @param intervalMS [DEFAULT_SYNC_INTERVAL_MS] Time between advertisements, 0 stops advertising
+     */
+    void SetSyncInterval(int intervalMS = DEFAULT_SYNC_INTERVAL_MS);
+
+
+    /**
+     * @brief Set how long a node that advertises its version may go unheard before its resources are removed
+     *
+     * Every packet from a node renews its lease, and its version advertisements keep it renewed while it is otherwise
+     * quiet, so the lease should span a few of the node's sync intervals. A shorter lease detects lost nodes sooner,
+     * at the cost of advertising more often. Only nodes that advertise are held to a lease, leases are off by default.
+     * Removals are reported on the radio's thread, like every other resource callback.
+     * @param leaseMS [DEFAULT_LEASE_MS] Lease, 0 keeps resources until they are removed explicitly
      */
-    void BroadcastData(const std::vector<uint8_t> &data);
+    void SetLease(int leaseMS = DEFAULT_LEASE_MS);
 
 
 
 protected:
 
-    void SendDataToAddress(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb);
+    /**
+     * @brief Send data to a node
+     * @param addr Address to send to
+     * @param data Data to send
+     * @param cb Called with the transmit status, may be empty
+     * @param priority [TELEMETRY] Class the data is queued in
+     * @param options [TransmitOptions()] Transmit options applied to every frame carrying the data
+     */
+    void SendDataToAddress(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb, TransmitPriority priority = TransmitPriority::TELEMETRY, const TransmitOptions &options = TransmitOptions());
+
+    /**
+     * @brief Send data to a node, resending it until the node acknowledges it
+     *
+     * Each destination holds up to RELIABLE_WINDOW unacknowledged messages. A message is resent when its retransmit
+     * timeout passes or when later messages are acknowledged ahead of it, and given up on after
+     * RELIABLE_MAX_TRANSMISSIONS transmissions. Only unicasts small enough for a single frame are supported.
+     * @param addr Address to send to
+     * @param data Data to send
+     * @param cb Called with SUCCESS once acknowledged, or TIMEOUT once given up on, may be empty
+     * @param priority [TELEMETRY] Class the data is queued in
+     * @return False if the destination already holds RELIABLE_WINDOW unacknowledged messages
+     */
+    bool SendReliableDataToAddress(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb, TransmitPriority priority = TransmitPriority::TELEMETRY);
 
     void RequestContainedResources(const ResourceKey &key) const;
 
@@ -102,6 +465,8 @@ protected:
 
     virtual std::vector<std::tuple<ResourceKey, ResourceValue>> RetrieveComponentItems(const ResourceKey &key, bool internal = false) = 0;
 
+    virtual std::vector<std::tuple<ResourceKey, ResourceValue>> RetrieveRemoteComponentItems(uint64_t addr) = 0;
+
 protected:
 
     /**
@@ -111,10 +476,166 @@ protected:
     void on_message_received(const std::vector<uint8_t> &msg, uint64_t addr);
 
 
+    /**
+     * @brief Send a byte array as a DATA packet, or as DATA_FRAGMENT packets if it exceeds the radio's maximum payload
+     * @param addr Address to send to
+     * @param data Data to send
+     * @param cb Called once with the first failing fragment's status, or SUCCESS, may be empty
+     * @param priority Class the data is queued in
+     * @param options Transmit options of each frame
+     */
+    void send_data(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb, TransmitPriority priority, const TransmitOptions &options);
+
+    /**
+     * @brief Combine the transmit statuses of a message sent in several packets into one
+     * @param count Number of packets, at least 1
+     * @param cb Called once every packet's status is in, with the first failing status or SUCCESS
+     * @return Callback to give each packet
+     */
+    static std::function<void(const TransmitStatusTypes &)> make_combined_status(size_t count, const std::function<void(const TransmitStatusTypes &)> &cb);
+
+    bool aggregate_data(uint64_t addr, const std::vector<uint8_t> &data, const std::function<void(const TransmitStatusTypes &)> &cb, size_t maxPayload);
+
+    void flush_aggregate(uint64_t addr);
+
+    void transmit_aggregate(uint64_t addr, PendingAggregate &aggregate);
+
+    /**
+     * @brief Hand a DATA path packet to the radio, compressing it if the peer supports this node's codec
+     */
+    void send_packet(uint64_t addr, std::vector<uint8_t> &packet, const std::function<void(const TransmitStatusTypes &)> &cb, TransmitPriority priority, const TransmitOptions &options = TransmitOptions());
+
+    /**
+     * @brief Hand a protocol packet to the radio without throwing, for senders on the link's or scheduler's thread
+     *
+     * A packet the radio can't take is dropped with a log line, every caller's protocol asks again later.
+     * @return True if the radio took the packet
+     */
+    bool send_packet_nothrow(uint64_t addr, const std::vector<uint8_t> &packet);
+
+    void send_capabilities(uint64_t addr);
+
+    bool decompress_packet(const std::vector<uint8_t> &msg, uint64_t addr, std::vector<uint8_t> &packet);
+
+    void send_reliable_message(uint64_t addr, uint8_t session, const ReliableSender::Message &message);
+
+    /**
+     * @brief Make sure a retransmit timer is pending for a destination with messages held, m_ReliableMutex must be held
+     */
+    void arm_retransmit_timer(uint64_t addr, ReliablePeer &peer);
+
+    void on_retransmit_timer(uint64_t addr);
+
+    void on_reliable_data(const std::vector<uint8_t> &msg, uint64_t addr);
+
+    void on_reliable_ack(const std::vector<uint8_t> &msg, uint64_t addr);
+
+    /**
+     * @brief Record a sequence number in a sender's window
+     * @return False if it was seen before
+     */
+    static bool accept_sequence(std::map<uint64_t, SenderWindow> &senders, uint64_t addr, uint8_t session, uint16_t sequence);
+
+
     void send_item_present_message(const ResourceKey &key, const ResourceValue &resource);
 
     void send_item_remove_message(const ResourceKey &key, const ResourceValue &resource);
 
+    /**
+     * @brief Announce several resources, packing as many v2 entries into each packet as the radio's payload allows
+     *
+     * Resources sent in the original encoding still take a packet each.
+     */
+    void send_item_present_messages(const std::vector<std::tuple<ResourceKey, ResourceValue>> &resources);
+
+    /**
+     * @brief Send resources in the configured encoding, the original one takes a packet per resource
+     * @param cb Called once with the first failing packet's status, or SUCCESS, may be empty
+     */
+    void send_resource_messages(PacketTypes legacyType, PacketTypes compactType, const std::vector<std::tuple<ResourceKey, ResourceValue>> &resources, uint64_t addr, const std::function<void(const TransmitStatusTypes &)> &cb);
+
+    /**
+     * @brief Bump the version of this node's resources, logging the change for delta sync requests
+     */
+    void record_registry_change(bool present, const ResourceKey &key, const ResourceValue &resource);
+
+    void send_version(PacketTypes type, uint64_t addr);
+
+    void on_version_advertise(const std::vector<uint8_t> &msg, uint64_t addr);
+
+    /**
+     * @brief Answer a sync request with the changes it asks for, or with every resource if they are no longer logged
+     */
+    void on_sync_request(const std::vector<uint8_t> &msg, uint64_t addr);
+
+    void on_sync_complete(const std::vector<uint8_t> &msg, uint64_t addr);
+
+    /**
+     * @brief Note a resource announced or removed by a node, for the response jitter and any sync request outstanding
+     * with it
+     */
+    void note_remote_resource(uint64_t addr, const ResourceKey &key, const ResourceValue &resource, bool present);
+
+    /**
+     * @brief Stop counting a node towards the response jitter once it holds no resources
+     */
+    void prune_known_node(uint64_t addr);
+
+    void renew_lease(uint64_t addr);
+
+    /**
+     * @brief Hand a lease check to the radio's thread, run periodically on the scheduler's thread
+     */
+    void check_leases();
+
+    /**
+     * @brief Remove the resources of nodes whose lease has passed, forgetting the nodes so they are synced afresh if
+     * they return
+     */
+    void expire_leases();
+
+    /**
+     * @brief Answer a contained resource request after the response jitter, or straight away if it is disabled
+     */
+    void reply_contained_resources(const std::vector<std::tuple<ResourceKey, ResourceValue>> &resources);
+
+    void send_pending_replies();
+
+    /**
+     * @brief Drop an item from the pending reply, another node has announced it
+     */
+    void suppress_reply(const ResourceKey &key, const ResourceValue &resource);
+
+    /**
+     * @brief Original encoding of a resource, every name spelled out followed by a 4 byte ID
+     */
+    static void encode_resource_v1(const ResourceKey &key, const ResourceValue &resource, std::vector<uint8_t> &packet);
+
+    /**
+     * @brief Compact encoding of a resource as one v2 entry, numbering names not seen before
+     * @param newNames Receives the IDs of names numbered by this call, m_NameMutex must be held
+     */
+    void encode_resource_v2(const ResourceKey &key, const ResourceValue &resource, std::vector<uint8_t> &packet, std::vector<uint32_t> &newNames);
+
+    /**
+     * @brief Send the definitions of name IDs, m_NameMutex must not be held
+     */
+    void send_name_definitions(uint64_t addr, const std::vector<uint32_t> &nameIDs);
+
+    /**
+     * @brief Handle a v2 resource packet, keeping it until the sender defines any names it uses that are unknown
+     */
+    void on_resource_packet_v2(const std::vector<uint8_t> &msg, uint64_t addr);
+
+    void on_name_definitions(const std::vector<uint8_t> &msg, uint64_t addr);
+
+    void on_name_request(const std::vector<uint8_t> &msg, uint64_t addr);
+
+    /**
+     * @brief Names known from a sender in the given epoch, forgetting those of an earlier epoch
+     */
+    PeerNames& peer_names(uint64_t addr, uint8_t epoch);
+
 };
 
 #endif // MACE_DIGIMESH_INTEROP_H
@@ -1,5 +1,37 @@
 #include "interop_component.h"
 
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+
+static void hash_bytes(uint64_t &hash, const uint8_t *data, size_t length)
+{
+    for(size_t i = 0 ; i < length ; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
+    }
+}
+
+
+/**
+ * @brief FNV-1a hash of an item and topic, used as the coalescing key of its latest state
+ */
+static uint64_t coalesce_key(const ResourceKey &resourceKey, const ResourceValue &resourceValue, const std::string &topic)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for(int i = 0 ; i < resourceKey.size() ; i++) {
+        // names are hashed with their terminator so ["ab", "c"] and ["a", "bc"] differ
+        hash_bytes(hash, (const uint8_t*)resourceKey.at(i).c_str(), resourceKey.at(i).size() + 1);
+    }
+    for(int i = 0 ; i < resourceValue.size() ; i++) {
+        int value = resourceValue.at(i);
+        hash_bytes(hash, (const uint8_t*)&value, sizeof(value));
+    }
+    hash_bytes(hash, (const uint8_t*)topic.c_str(), topic.size());
+
+    // zero means no coalescing
+    return hash == 0 ? 1 : hash;
+}
+
 /**
  * @brief Constructor
  *
@@ -109,9 +141,56 @@ void InteropComponent::AddHandler_ComponentItemTransmitError_Generic(const std::
  * @param component Name of component to send to
  * @param destVechileID ID of item
  * @param data Data to send
+ * @param priority [TELEMETRY] Class the data is queued in
+ * @param options [TransmitOptions()] Transmit options of the frames carrying the data
+ * @return False if given ID/component doesn't exists
+ */
+bool InteropComponent::SendData(const ResourceKey &resourceKey, const ResourceValue &resourceValue, const std::vector<uint8_t> &data, TransmitPriority priority, const TransmitOptions &options)
+{
+    SendDataToAddress(resource_address(resourceKey, resourceValue), data, transmit_error_notifier(resourceKey, resourceValue), priority, options);
+
+    return true;
+}
+
+
+/**
+ * @brief Send data to a component item, resending it until the item's node acknowledges it
+ *
+ * Transmit error handlers are called with TIMEOUT if the node never acknowledges the data.
+ * @param key Name of component to send to
+ * @param resource ID of item
+ * @param data Data to send, must fit in a single frame
+ * @param priority [TELEMETRY] Class the data is queued in
+ * @return False if too many messages to the item's node are awaiting acknowledgement
+ */
+bool InteropComponent::SendDataReliable(const ResourceKey &resourceKey, const ResourceValue &resourceValue, const std::vector<uint8_t> &data, TransmitPriority priority)
+{
+    return SendReliableDataToAddress(resource_address(resourceKey, resourceValue), data, transmit_error_notifier(resourceKey, resourceValue), priority);
+}
+
+
+/**
+ * @brief Send state where only the newest value matters, such as a position or attitude update
+ *
+ * Data sent to the same item under the same topic replaces the previous data if that is still waiting in the
+ * radio's transmit queue, so a congested link carries the freshest state rather than a backlog. Data needing
+ * fragmentation is never replaced.
+ * @param key Name of component to send to
+ * @param resource ID of item
+ * @param topic Kind of state the data carries
+ * @param data Data to send
+ * @param priority [TELEMETRY] Class the data is queued in
  * @return False if given ID/component doesn't exists
  */
-bool InteropComponent::SendData(const ResourceKey &resourceKey, const ResourceValue &resourceValue, const std::vector<uint8_t> &data)
+bool InteropComponent::SendDataLatest(const ResourceKey &resourceKey, const ResourceValue &resourceValue, const std::string &topic, const std::vector<uint8_t> &data, TransmitPriority priority)
+{
+    TransmitOptions options;
+    options.coalesceKey = coalesce_key(resourceKey, resourceValue, topic);
+    return SendData(resourceKey, resourceValue, data, priority, options);
+}
+
+
+uint64_t InteropComponent::resource_address(const ResourceKey &resourceKey, const ResourceValue &resourceValue)
 {
     if(m_Resources.HasAddr(resourceKey, resourceValue) == false)
     {
@@ -130,12 +209,16 @@ bool InteropComponent::SendData(const ResourceKey &resourceKey, const ResourceVa
         throw std::runtime_error("No address known for given target: " + str);
     }
 
-    //address to send to
-    uint64_t addr = m_Resources.GetAddr(resourceKey, resourceValue);
+    return m_Resources.GetAddr(resourceKey, resourceValue);
+}
+
 
-    SendDataToAddress(addr, data, [this, resourceKey, resourceValue](const TransmitStatusTypes &status){
+std::function<void(const TransmitStatusTypes &)> InteropComponent::transmit_error_notifier(const ResourceKey &resourceKey, const ResourceValue &resourceValue)
+{
+    return [this, resourceKey, resourceValue](const TransmitStatusTypes &status){
 
-        if(status != TransmitStatusTypes::SUCCESS)
+        // a message replaced by newer state did not fail to reach the item
+        if(status != TransmitStatusTypes::SUCCESS && status != TransmitStatusTypes::SUPERSEDED)
         {
             if(m_Handlers_VehicleNotReached.find(resourceKey) != m_Handlers_VehicleNotReached.cend())
             {
@@ -145,9 +228,7 @@ bool InteropComponent::SendData(const ResourceKey &resourceKey, const ResourceVa
                 Notify<ResourceKey, ResourceValue, TransmitStatusTypes>(m_Handlers_VehicleNotReached_Generic, resourceKey, resourceValue, status);
             }
         }
-    });
-
-    return true;
+    };
 }
 
 
@@ -189,3 +270,9 @@ std::vector<std::tuple<ResourceKey, ResourceValue>> InteropComponent::RetrieveCo
 {
     return m_Resources.getResourcesMatch(key, true, internal);
 }
+
+
+std::vector<std::tuple<ResourceKey, ResourceValue>> InteropComponent::RetrieveRemoteComponentItems(uint64_t addr)
+{
+    return m_Resources.getResourcesAt(addr);
+}
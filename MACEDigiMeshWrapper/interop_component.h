@@ -21,6 +21,12 @@ private:
 
     ResourceList m_Resources;
 
+private:
+
+    uint64_t resource_address(const ResourceKey &resourceKey, const ResourceValue &resourceValue);
+
+    std::function<void(const TransmitStatusTypes &)> transmit_error_notifier(const ResourceKey &resourceKey, const ResourceValue &resourceValue);
+
 
 public:
     /**
@@ -99,9 +105,40 @@ protected:
      * @param component Name of component to send to
      * @param destVechileID ID of item
      * @param data Data to send
+     * @param priority [TELEMETRY] Class the data is queued in
+     * @param options [TransmitOptions()] Transmit options of the frames carrying the data
      * @return False if given ID/component doesn't exists
      */
-    bool SendData(const ResourceKey &key, const ResourceValue &resource, const std::vector<uint8_t> &data);
+    bool SendData(const ResourceKey &key, const ResourceValue &resource, const std::vector<uint8_t> &data, TransmitPriority priority = TransmitPriority::TELEMETRY, const TransmitOptions &options = TransmitOptions());
+
+
+    /**
+     * @brief Send data to a component item, resending it until the item's node acknowledges it
+     *
+     * Transmit error handlers are called with TIMEOUT if the node never acknowledges the data.
+     * @param key Name of component to send to
+     * @param resource ID of item
+     * @param data Data to send, must fit in a single frame
+     * @param priority [TELEMETRY] Class the data is queued in
+     * @return False if too many messages to the item's node are awaiting acknowledgement
+     */
+    bool SendDataReliable(const ResourceKey &key, const ResourceValue &resource, const std::vector<uint8_t> &data, TransmitPriority priority = TransmitPriority::TELEMETRY);
+
+
+    /**
+     * @brief Send state where only the newest value matters, such as a position or attitude update
+     *
+     * Data sent to the same item under the same topic replaces the previous data if that is still waiting in the
+     * radio's transmit queue, so a congested link carries the freshest state rather than a backlog. Data needing
+     * fragmentation is never replaced.
+     * @param key Name of component to send to
+     * @param resource ID of item
+     * @param topic Kind of state the data carries
+     * @param data Data to send
+     * @param priority [TELEMETRY] Class the data is queued in
+     * @return False if given ID/component doesn't exists
+     */
+    bool SendDataLatest(const ResourceKey &key, const ResourceValue &resource, const std::string &topic, const std::vector<uint8_t> &data, TransmitPriority priority = TransmitPriority::TELEMETRY);
 
 protected:
 
@@ -112,6 +149,8 @@ protected:
 
     virtual std::vector<std::tuple<ResourceKey, ResourceValue> > RetrieveComponentItems(const ResourceKey &key, bool internal = false);
 
+    virtual std::vector<std::tuple<ResourceKey, ResourceValue> > RetrieveRemoteComponentItems(uint64_t addr);
+
 
 protected:
 
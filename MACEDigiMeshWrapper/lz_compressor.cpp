@@ -0,0 +1,189 @@
+#include "lz_compressor.h"
+
+#include <cstring>
+#include <algorithm>
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+#define LZ_HASH_BITS 12
+
+
+static uint32_t hash_sequence(const uint8_t *data)
+{
+    uint32_t sequence;
+    memcpy(&sequence, data, sizeof(sequence));
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+
+/**
+ * @brief Constructor
+ * @param dictionary [{}] Preset dictionary, only its last LZ_MAX_DICTIONARY_LENGTH bytes are used
+ * @param id [LZ_COMPRESSOR_ID] ID to advertise, must be unique per dictionary
+ */
+LZCompressor::LZCompressor(const std::vector<uint8_t> &dictionary, uint8_t id) :
+    m_ID(id)
+{
+    size_t length = std::min<size_t>(dictionary.size(), LZ_MAX_DICTIONARY_LENGTH);
+    m_Dictionary.assign(dictionary.end() - length, dictionary.end());
+}
+
+
+uint8_t LZCompressor::ID() const
+{
+    return m_ID;
+}
+
+
+bool LZCompressor::Compress(const uint8_t *data, size_t length, std::vector<uint8_t> &out) const
+{
+    out.clear();
+    out.reserve(length);
+
+    // matches are searched over the dictionary followed by the data, so offsets may reach back into the dictionary
+    std::vector<uint8_t> window;
+    window.reserve(m_Dictionary.size() + length);
+    window.insert(window.end(), m_Dictionary.begin(), m_Dictionary.end());
+    window.insert(window.end(), data, data + length);
+
+    const size_t start = m_Dictionary.size();
+    const size_t end = window.size();
+
+    // positions are stored plus one so zero marks an empty entry
+    std::vector<uint32_t> table(1 << LZ_HASH_BITS, 0);
+    for(size_t i = 0 ; i + LZ_MIN_MATCH <= start ; i++) {
+        table[hash_sequence(&window[i])] = i + 1;
+    }
+
+    size_t anchor = start;
+    size_t pos = start;
+    while(pos + LZ_MIN_MATCH <= end)
+    {
+        uint32_t hash = hash_sequence(&window[pos]);
+        size_t candidate = table[hash];
+        table[hash] = pos + 1;
+
+        if(candidate == 0 || pos - (candidate - 1) > LZ_MAX_OFFSET || memcmp(&window[candidate - 1], &window[pos], LZ_MIN_MATCH) != 0)
+        {
+            pos++;
+            continue;
+        }
+        candidate--;
+
+        size_t matchLength = LZ_MIN_MATCH;
+        while(pos + matchLength < end && window[candidate + matchLength] == window[pos + matchLength]) {
+            matchLength++;
+        }
+
+        size_t literals = pos - anchor;
+        out.push_back((uint8_t)((std::min<size_t>(literals, 15) << 4) | std::min<size_t>(matchLength - LZ_MIN_MATCH, 15)));
+        if(literals >= 15) {
+            write_length(out, literals - 15);
+        }
+        out.insert(out.end(), window.begin() + anchor, window.begin() + pos);
+
+        size_t offset = pos - candidate;
+        out.push_back(offset & 0xFF);
+        out.push_back((offset >> 8) & 0xFF);
+        if(matchLength - LZ_MIN_MATCH >= 15) {
+            write_length(out, matchLength - LZ_MIN_MATCH - 15);
+        }
+
+        pos += matchLength;
+        anchor = pos;
+
+        if(out.size() >= length) {
+            return false;
+        }
+    }
+
+    size_t literals = end - anchor;
+    out.push_back((uint8_t)(std::min<size_t>(literals, 15) << 4));
+    if(literals >= 15) {
+        write_length(out, literals - 15);
+    }
+    out.insert(out.end(), window.begin() + anchor, window.end());
+
+    return out.size() < length;
+}
+
+
+bool LZCompressor::Decompress(const uint8_t *data, size_t length, std::vector<uint8_t> &out) const
+{
+    const uint8_t *in = data;
+    const uint8_t *end = data + length;
+    const size_t start = m_Dictionary.size();
+
+    out.assign(m_Dictionary.begin(), m_Dictionary.end());
+
+    while(in < end)
+    {
+        uint8_t token = *in++;
+
+        size_t literals = token >> 4;
+        if(literals == 15 && !read_length(in, end, literals)) {
+            return false;
+        }
+        if((size_t)(end - in) < literals || out.size() - start + literals > LZ_MAX_DECOMPRESSED_LENGTH) {
+            return false;
+        }
+        out.insert(out.end(), in, in + literals);
+        in += literals;
+
+        if(in == end) {
+            break;
+        }
+
+        if(end - in < 2) {
+            return false;
+        }
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+
+        size_t matchLength = token & 0x0F;
+        if(matchLength == 15 && !read_length(in, end, matchLength)) {
+            return false;
+        }
+        matchLength += LZ_MIN_MATCH;
+
+        if(offset == 0 || offset > out.size() || out.size() - start + matchLength > LZ_MAX_DECOMPRESSED_LENGTH) {
+            return false;
+        }
+
+        // copied a byte at a time, a match may overlap the bytes it produces
+        size_t from = out.size() - offset;
+        for(size_t i = 0 ; i < matchLength ; i++) {
+            out.push_back(out[from + i]);
+        }
+    }
+
+    out.erase(out.begin(), out.begin() + start);
+    return true;
+}
+
+
+void LZCompressor::write_length(std::vector<uint8_t> &out, size_t length)
+{
+    while(length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back((uint8_t)length);
+}
+
+
+bool LZCompressor::read_length(const uint8_t *&in, const uint8_t *end, size_t &length)
+{
+    uint8_t byte;
+    do
+    {
+        if(in == end) {
+            return false;
+        }
+        byte = *in++;
+        length += byte;
+    }
+    while(byte == 255);
+
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef LZ_COMPRESSOR_H
+#define LZ_COMPRESSOR_H
+
+#include "i_compressor.h"
+
+#define LZ_COMPRESSOR_ID 0x01
+#define LZ_MAX_DICTIONARY_LENGTH 65535
+#define LZ_MAX_DECOMPRESSED_LENGTH 65536
+
+
+/**
+ * @brief LZ4 style byte oriented compressor, optionally primed with a preset dictionary
+ *
+ * Output is a series of sequences, each a token byte holding the literal length in its high nibble and the match
+ * length minus four in its low nibble (a nibble of 15 is extended by following bytes until one is below 255), the
+ * literals, then a two byte little endian offset back into the output. The last sequence carries literals only.
+ *
+ * A dictionary of bytes typical of the payloads, such as a recorded telemetry message, behaves as if it preceded every
+ * message, so even short messages find matches. Both ends must be given the same dictionary and ID.
+ */
+class LZCompressor : public ICompressor
+{
+private:
+
+    uint8_t m_ID;
+    std::vector<uint8_t> m_Dictionary;
+
+public:
+
+    /**
+     * @brief Constructor
+     * @param dictionary [{}] Preset dictionary, only its last LZ_MAX_DICTIONARY_LENGTH bytes are used
+     * @param id [LZ_COMPRESSOR_ID] ID to advertise, must be unique per dictionary
+     */
+    LZCompressor(const std::vector<uint8_t> &dictionary = {}, uint8_t id = LZ_COMPRESSOR_ID);
+
+    virtual uint8_t ID() const;
+
+    virtual bool Compress(const uint8_t *data, size_t length, std::vector<uint8_t> &out) const;
+
+    virtual bool Decompress(const uint8_t *data, size_t length, std::vector<uint8_t> &out) const;
+
+private:
+
+    static void write_length(std::vector<uint8_t> &out, size_t length);
+
+    static bool read_length(const uint8_t *&in, const uint8_t *end, size_t &length);
+};
+
+#endif // LZ_COMPRESSOR_H
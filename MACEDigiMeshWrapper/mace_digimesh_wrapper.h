@@ -152,6 +152,21 @@ public:
         return InteropComponent::SendData(key, value, data);
     }
 
+    bool SendData(const std::vector<uint8_t> &data, const ResourceKey &key, const ResourceValue &value, TransmitPriority priority, const TransmitOptions &options = TransmitOptions())
+    {
+        return InteropComponent::SendData(key, value, data, priority, options);
+    }
+
+    bool SendDataReliable(const std::vector<uint8_t> &data, const ResourceKey &key, const ResourceValue &value, TransmitPriority priority = TransmitPriority::TELEMETRY)
+    {
+        return InteropComponent::SendDataReliable(key, value, data, priority);
+    }
+
+    bool SendDataLatest(const std::vector<uint8_t> &data, const ResourceKey &key, const ResourceValue &value, const std::string &topic, TransmitPriority priority = TransmitPriority::TELEMETRY)
+    {
+        return InteropComponent::SendDataLatest(key, value, topic, data, priority);
+    }
+
     template<const char* ...str, typename... Args>
     bool SendData(const std::vector<uint8_t> &data, Args... args) // recursive variadic function
     {
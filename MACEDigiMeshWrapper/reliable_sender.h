@@ -0,0 +1,272 @@
+#ifndef RELIABLE_SENDER_H
+#define RELIABLE_SENDER_H
+
+#include <stdint.h>
+#include <cstddef>
+#include <cmath>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <functional>
+
+#include "transmit_status_types.h"
+#include "transmit_priority.h"
+
+#define RELIABLE_WINDOW 32
+#define RELIABLE_MAX_TRANSMISSIONS 6
+#define RELIABLE_INITIAL_RTO_MS 1000
+#define RELIABLE_MIN_RTO_MS 200
+#define RELIABLE_MAX_RTO_MS 16000
+// later messages acknowledged past an unacknowledged one before it is resent without waiting on its timeout
+#define RELIABLE_FAST_RETRANSMIT 3
+
+
+/**
+ * @brief Sending half of a reliable channel to one peer, holding messages until the peer acknowledges them.
+ *
+ * Messages are numbered consecutively and at most RELIABLE_WINDOW of them are held at once. Acknowledgements carry
+ * the peer's next expected sequence number, covering everything before it, and a bitmap of the 32 numbers after it
+ * that were received.
+ *
+ * The retransmit timeout follows RFC 6298, a smoothed round trip time plus four times its variation, estimated only
+ * from messages acknowledged on their first transmission and doubled each time the timer expires. A message
+ * unacknowledged after RELIABLE_MAX_TRANSMISSIONS transmissions is given up on.
+ *
+ * Each sender picks a random session number and first sequence number, so a peer can tell a restarted sender from
+ * repeats of old messages.
+ *
+ * The sender performs no locking, the owner is responsible for synchronizing access.
+ */
+class ReliableSender
+{
+public:
+
+    struct Message
+    {
+        uint16_t sequence;
+        std::vector<uint8_t> data;
+        TransmitPriority priority;
+        std::function<void(const TransmitStatusTypes &)> cb;
+        std::chrono::steady_clock::time_point sent;
+        unsigned int transmissions;
+        unsigned int skipped;
+    };
+
+private:
+
+    std::deque<Message> m_Messages;
+    uint8_t m_Session;
+    uint16_t m_NextSequence;
+
+    size_t m_Window;
+    unsigned int m_MaxTransmissions;
+
+    // seconds, zero until the first sample
+    double m_SmoothedRTT;
+    double m_RTTVariation;
+    std::chrono::milliseconds m_RTO;
+
+    size_t m_Retransmissions;
+
+public:
+
+    /**
+     * @brief Constructor
+     * @param window [RELIABLE_WINDOW] Number of unacknowledged messages held at once, at most RELIABLE_WINDOW
+     * @param maxTransmissions [RELIABLE_MAX_TRANSMISSIONS] Transmissions of a message before it is given up on
+     */
+    ReliableSender(size_t window = RELIABLE_WINDOW, unsigned int maxTransmissions = RELIABLE_MAX_TRANSMISSIONS) :
+        m_Window(std::min<size_t>(window, RELIABLE_WINDOW)),
+        m_MaxTransmissions(maxTransmissions),
+        m_SmoothedRTT(0),
+        m_RTTVariation(0),
+        m_RTO(RELIABLE_INITIAL_RTO_MS),
+        m_Retransmissions(0)
+    {
+        std::random_device random;
+        m_Session = random() & 0xFF;
+        m_NextSequence = random() & 0xFFFF;
+    }
+
+    uint8_t Session() const
+    {
+        return m_Session;
+    }
+
+    bool Empty() const
+    {
+        return m_Messages.empty();
+    }
+
+    bool Full() const
+    {
+        return m_Messages.size() >= m_Window;
+    }
+
+    std::chrono::milliseconds RetransmitTimeout() const
+    {
+        return m_RTO;
+    }
+
+    /**
+     * @brief Number of messages sent again, whether on a timeout or a gap in the acknowledgements
+     */
+    size_t Retransmissions() const
+    {
+        return m_Retransmissions;
+    }
+
+    /**
+     * @brief Number and hold a message about to be transmitted for the first time, the sender must not be full
+     * @return The held message
+     */
+    const Message& Push(const std::vector<uint8_t> &data, TransmitPriority priority, const std::function<void(const TransmitStatusTypes &)> &cb, const std::chrono::steady_clock::time_point &now)
+    {
+        Message message;
+        message.sequence = m_NextSequence++;
+        message.data = data;
+        message.priority = priority;
+        message.cb = cb;
+        message.sent = now;
+        message.transmissions = 1;
+        message.skipped = 0;
+        m_Messages.push_back(std::move(message));
+        return m_Messages.back();
+    }
+
+    /**
+     * @brief Release the messages covered by an acknowledgement
+     * @param session Session the acknowledgement was sent for, acknowledgements for another session are ignored
+     * @param expected Peer's next expected sequence number
+     * @param selective Which of the 32 sequence numbers following expected the peer received
+     * @param now Current time
+     * @param acked Receives the acknowledged messages
+     * @param retransmit Receives copies of messages to send again straight away
+     */
+    void OnAck(uint8_t session, uint16_t expected, uint32_t selective, const std::chrono::steady_clock::time_point &now, std::vector<Message> &acked, std::vector<Message> &retransmit)
+    {
+        if(session != m_Session) {
+            return;
+        }
+
+        // furthest sequence number the peer reports, messages before it that are still missing were likely lost
+        int highest = -1;
+        for(int i = 31 ; i >= 0 ; i--) {
+            if(selective & ((uint32_t)1 << i)) {
+                highest = i + 1;
+                break;
+            }
+        }
+
+        std::deque<Message>::iterator it = m_Messages.begin();
+        while(it != m_Messages.end())
+        {
+            int distance = (int16_t)(uint16_t)(it->sequence - expected);
+            bool received = distance < 0 || (distance >= 1 && distance <= 32 && (selective & ((uint32_t)1 << (distance - 1))));
+            if(received)
+            {
+                if(it->transmissions == 1) {
+                    sample(now - it->sent);
+                }
+                acked.push_back(std::move(*it));
+                it = m_Messages.erase(it);
+                continue;
+            }
+
+            if(distance < highest)
+            {
+                it->skipped++;
+                if(it->skipped == RELIABLE_FAST_RETRANSMIT && it->transmissions < m_MaxTransmissions) {
+                    resend(*it, now, retransmit);
+                }
+            }
+            ++it;
+        }
+    }
+
+    /**
+     * @brief Resend or give up on messages whose retransmit timeout has passed
+     * @param now Current time
+     * @param retransmit Receives copies of messages to send again
+     * @param failed Receives messages given up on
+     */
+    void OnTimer(const std::chrono::steady_clock::time_point &now, std::vector<Message> &retransmit, std::vector<Message> &failed)
+    {
+        bool expired = false;
+        std::deque<Message>::iterator it = m_Messages.begin();
+        while(it != m_Messages.end())
+        {
+            if(now - it->sent < m_RTO)
+            {
+                ++it;
+                continue;
+            }
+
+            expired = true;
+            if(it->transmissions >= m_MaxTransmissions)
+            {
+                failed.push_back(std::move(*it));
+                it = m_Messages.erase(it);
+                continue;
+            }
+            resend(*it, now, retransmit);
+            ++it;
+        }
+
+        if(expired) {
+            m_RTO = std::min(m_RTO * 2, std::chrono::milliseconds(RELIABLE_MAX_RTO_MS));
+        }
+    }
+
+    /**
+     * @brief Time until the oldest transmission's timeout passes, the sender must not be empty
+     */
+    std::chrono::milliseconds TimeUntilDue(const std::chrono::steady_clock::time_point &now) const
+    {
+        std::chrono::steady_clock::time_point due = m_Messages.front().sent;
+        for(std::deque<Message>::const_iterator it = m_Messages.begin() ; it != m_Messages.end() ; ++it) {
+            due = std::min(due, it->sent);
+        }
+        due += m_RTO;
+
+        if(due <= now) {
+            return std::chrono::milliseconds(0);
+        }
+        return std::chrono::duration_cast<std::chrono::milliseconds>(due - now) + std::chrono::milliseconds(1);
+    }
+
+private:
+
+    void resend(Message &message, const std::chrono::steady_clock::time_point &now, std::vector<Message> &retransmit)
+    {
+        message.transmissions++;
+        message.sent = now;
+        m_Retransmissions++;
+
+        Message copy = message;
+        copy.cb = nullptr;
+        retransmit.push_back(std::move(copy));
+    }
+
+    void sample(const std::chrono::steady_clock::duration &rtt)
+    {
+        double seconds = std::chrono::duration<double>(rtt).count();
+        if(m_SmoothedRTT == 0)
+        {
+            m_SmoothedRTT = seconds;
+            m_RTTVariation = seconds / 2;
+        }
+        else
+        {
+            m_RTTVariation = 0.75 * m_RTTVariation + 0.25 * std::fabs(m_SmoothedRTT - seconds);
+            m_SmoothedRTT = 0.875 * m_SmoothedRTT + 0.125 * seconds;
+        }
+
+        long long rto = (long long)((m_SmoothedRTT + 4 * m_RTTVariation) * 1000);
+        m_RTO = std::chrono::milliseconds(std::max<long long>(RELIABLE_MIN_RTO_MS, std::min<long long>(RELIABLE_MAX_RTO_MS, rto)));
+    }
+};
+
+#endif // RELIABLE_SENDER_H
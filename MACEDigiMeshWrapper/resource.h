@@ -201,12 +201,15 @@ private:
     std::unordered_map<ResourceKey, std::vector<ResourceValue>> m_InternalResources;
     std::unordered_map<ResourceKey, std::unordered_map<ResourceValue, uint64_t>> m_ResourcesToRadioAddr;
 
-    std::mutex m_Mutex;
+    // external resources may expire on another thread than the one adding them, every access is guarded
+    mutable std::mutex m_Mutex;
 
 public:
 
     void AddInternalResource(const ResourceKey &key, const ResourceValue &value)
     {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
         if(m_ResourcesToRadioAddr.find(key) == m_ResourcesToRadioAddr.cend())
         {
             m_ResourcesToRadioAddr.insert({key, {}});
@@ -217,15 +220,15 @@ public:
             throw std::runtime_error("Resource of given ID already exists");
         }
 
-        m_Mutex.lock();
         m_ResourcesToRadioAddr.at(key).insert({value, 0x00});
-        m_Mutex.unlock();
 
         m_InternalResources.at(key).push_back(value);
     }
 
     void RemoveInternalResource(const ResourceKey &key, const ResourceValue &value)
     {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
         if(m_ResourcesToRadioAddr.find(key) == m_ResourcesToRadioAddr.cend())
         {
             return;
@@ -235,9 +238,7 @@ public:
             return;
         }
 
-        m_Mutex.lock();
         m_ResourcesToRadioAddr.at(key).erase(m_ResourcesToRadioAddr.at(key).find(value));
-        m_Mutex.unlock();
 
         for(auto it = m_InternalResources.at(key).cbegin() ; it != m_InternalResources.at(key).cend() ; ++it)
         {
@@ -258,6 +259,8 @@ public:
     //!
     bool AddExternalResource(const ResourceKey &key, const ResourceValue &value, uint64_t addr)
     {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
         if(m_ResourcesToRadioAddr.find(key) == m_ResourcesToRadioAddr.cend())
         {
             m_ResourcesToRadioAddr.insert({key, {}});
@@ -274,15 +277,15 @@ public:
             return false;
         }
 
-        m_Mutex.lock();
         m_ResourcesToRadioAddr.at(key).insert({value, addr});
-        m_Mutex.unlock();
 
         return true;
     }
 
     void RemoveExternalResource(const ResourceKey &key, const ResourceValue &value)
     {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
         if(m_ResourcesToRadioAddr.find(key) == m_ResourcesToRadioAddr.cend())
         {
             return;
@@ -292,13 +295,13 @@ public:
             return;
         }
 
-        m_Mutex.lock();
         m_ResourcesToRadioAddr.at(key).erase(m_ResourcesToRadioAddr.at(key).find(value));
-        m_Mutex.unlock();
     }
 
     bool HasAddr(const ResourceKey &key, const ResourceValue &value) const
     {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
         if(m_ResourcesToRadioAddr.find(key) == m_ResourcesToRadioAddr.cend())
         {
             return false;
@@ -313,6 +316,8 @@ public:
 
     uint64_t GetAddr(const ResourceKey &key, const ResourceValue &value)
     {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
         return m_ResourcesToRadioAddr.at(key).at(value);
     }
 
@@ -320,7 +325,7 @@ public:
     {
         std::vector<std::tuple<ResourceKey, ResourceValue>> rtn;
 
-        m_Mutex.lock();
+        std::lock_guard<std::mutex> lock(m_Mutex);
         for(auto it = m_ResourcesToRadioAddr.cbegin() ; it != m_ResourcesToRadioAddr.cend() ; ++it)
         {
             ResourceKey keyToCheck = it->first;
@@ -337,7 +342,30 @@ public:
                 }
             }
         }
-        m_Mutex.unlock();
+
+        return rtn;
+    }
+
+    //!
+    //! \brief Get every external resource reached through the given radio address
+    //! \param addr Address of the node holding the resources
+    //! \return Resources at the address
+    //!
+    std::vector<std::tuple<ResourceKey, ResourceValue>> getResourcesAt(uint64_t addr)
+    {
+        std::vector<std::tuple<ResourceKey, ResourceValue>> rtn;
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for(auto it = m_ResourcesToRadioAddr.cbegin() ; it != m_ResourcesToRadioAddr.cend() ; ++it)
+        {
+            for(auto itt = it->second.cbegin() ; itt != it->second.cend() ; ++itt)
+            {
+                if(itt->second == addr)
+                {
+                    rtn.push_back(std::make_tuple(it->first, itt->first));
+                }
+            }
+        }
 
         return rtn;
     }
@@ -0,0 +1,130 @@
+#ifndef SEQUENCE_WINDOW_H
+#define SEQUENCE_WINDOW_H
+
+#include <stdint.h>
+#include <cstddef>
+
+#define SEQUENCE_WINDOW_SPAN 64
+
+
+/**
+ * @brief Tracks which of a sender's 16 bit sequence numbers have been received, to tell new messages from repeats.
+ *
+ * Every sequence number before the expected one has been received or given up on. A 64 bit map records the ones
+ * received at and after the expected number, so each check is a shift and a mask. A sequence number more than
+ * SEQUENCE_WINDOW_SPAN ahead slides the window forward, abandoning the oldest gaps.
+ *
+ * The window performs no locking, the owner is responsible for synchronizing access.
+ */
+class SequenceWindow
+{
+private:
+
+    bool m_Synced;
+    uint16_t m_Expected;
+    // bit i set when m_Expected + i has been received, bit 0 is always clear
+    uint64_t m_Received;
+
+    size_t m_Duplicates;
+
+public:
+
+    SequenceWindow() :
+        m_Synced(false),
+        m_Expected(0),
+        m_Received(0),
+        m_Duplicates(0)
+    {
+    }
+
+    /**
+     * @brief Forget every sequence number seen, the next one accepted starts the window over
+     */
+    void Reset()
+    {
+        m_Synced = false;
+        m_Received = 0;
+    }
+
+    /**
+     * @brief Record a sequence number
+     * @param sequence Sequence number of the received message
+     * @return True if it had not been received before
+     */
+    bool Accept(uint16_t sequence)
+    {
+        if(!m_Synced)
+        {
+            m_Synced = true;
+            m_Expected = sequence;
+            m_Received = 0;
+        }
+
+        int16_t distance = (int16_t)(uint16_t)(sequence - m_Expected);
+        if(distance < 0)
+        {
+            m_Duplicates++;
+            return false;
+        }
+        if(distance >= SEQUENCE_WINDOW_SPAN)
+        {
+            slide(distance - SEQUENCE_WINDOW_SPAN + 1);
+            distance = (int16_t)(uint16_t)(sequence - m_Expected);
+        }
+
+        uint64_t bit = (uint64_t)1 << distance;
+        if(m_Received & bit)
+        {
+            m_Duplicates++;
+            return false;
+        }
+        m_Received |= bit;
+
+        while(m_Received & 1)
+        {
+            m_Received >>= 1;
+            m_Expected++;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Lowest sequence number not yet received, every one before it has been
+     */
+    uint16_t Expected() const
+    {
+        return m_Expected;
+    }
+
+    /**
+     * @brief Which of the 32 sequence numbers following Expected have been received, bit i for Expected + 1 + i
+     */
+    uint32_t Selective() const
+    {
+        return (uint32_t)(m_Received >> 1);
+    }
+
+    /**
+     * @brief Number of repeated sequence numbers turned away
+     */
+    size_t Duplicates() const
+    {
+        return m_Duplicates;
+    }
+
+private:
+
+    void slide(size_t count)
+    {
+        m_Received = count >= SEQUENCE_WINDOW_SPAN ? 0 : m_Received >> count;
+        m_Expected += count;
+
+        while(m_Received & 1)
+        {
+            m_Received >>= 1;
+            m_Expected++;
+        }
+    }
+};
+
+#endif // SEQUENCE_WINDOW_H
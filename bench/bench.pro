@@ -0,0 +1,11 @@
+TEMPLATE = subdirs
+
+# Benchmarks are plain console programs, run them from the build directory and read the report they print.
+
+unix: SUBDIRS += \
+    pty_latency \
+    parser_throughput \
+    encoder_throughput \
+    codec_ratio \
+    response_jitter_sim \
+    resource_replies
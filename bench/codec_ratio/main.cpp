@@ -0,0 +1,269 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lz_compressor.h"
+
+//
+// Compresses a set of DATA payloads with LZCompressor, with and without a preset dictionary, and reports the
+// compression ratio and the CPU time spent per message.
+//
+// Payloads are read from a file holding one payload per line as hex, such as a capture of what MACE handed to
+// Interop. Without a file a synthetic telemetry stream is used: MAVLink v1 heartbeat, system status, attitude and
+// global position messages whose fields drift the way a vehicle's do.
+//
+// The dictionary is built from the first messages of the set, those messages are then left out of the measurement.
+//
+// Usage: codec_ratio [payload file]
+//
+
+#define SYNTHETIC_MESSAGES 4000
+#define DICTIONARY_MESSAGES 16
+#define TIMING_ROUNDS 20
+
+typedef std::chrono::steady_clock Clock;
+
+
+static bool read_payloads(const char *path, std::vector<std::vector<uint8_t>> &payloads)
+{
+    std::ifstream file(path);
+    if(!file.is_open())
+    {
+        return false;
+    }
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        std::vector<uint8_t> payload;
+        for(size_t i = 0 ; i + 1 < line.size() ; i += 2)
+        {
+            payload.push_back((uint8_t)strtoul(line.substr(i, 2).c_str(), NULL, 16));
+        }
+        if(payload.size() > 0)
+        {
+            payloads.push_back(payload);
+        }
+    }
+    return true;
+}
+
+
+//!
+//! \brief Builds MAVLink v1 frames, the checksum is the X.25 CRC MAVLink uses, without its per message seed
+//!
+class MavlinkWriter
+{
+private:
+
+    uint8_t m_Sequence;
+    std::vector<uint8_t> m_Payload;
+
+public:
+
+    MavlinkWriter() :
+        m_Sequence(0)
+    {
+    }
+
+    template <typename T>
+    MavlinkWriter& Put(T value)
+    {
+        uint8_t bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        m_Payload.insert(m_Payload.end(), bytes, bytes + sizeof(T));
+        return *this;
+    }
+
+    std::vector<uint8_t> Finish(uint8_t messageID)
+    {
+        std::vector<uint8_t> frame = {0xFE, (uint8_t)m_Payload.size(), m_Sequence++, 1, 1, messageID};
+        frame.insert(frame.end(), m_Payload.begin(), m_Payload.end());
+        m_Payload.clear();
+
+        uint16_t crc = 0xFFFF;
+        for(size_t i = 1 ; i < frame.size() ; i++)
+        {
+            uint8_t tmp = frame[i] ^ (uint8_t)(crc & 0xFF);
+            tmp ^= (tmp << 4);
+            crc = (crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+        }
+        frame.push_back(crc & 0xFF);
+        frame.push_back(crc >> 8);
+        return frame;
+    }
+};
+
+
+static void synthesize_payloads(std::vector<std::vector<uint8_t>> &payloads)
+{
+    std::mt19937 random(1);
+    std::normal_distribution<float> drift(0.0f, 1.0f);
+
+    MavlinkWriter writer;
+    uint32_t timeMS = 0;
+    float roll = 0, pitch = 0, yaw = 1.2f;
+    int32_t lat = 389051000, lon = -770365000, alt = 120000;
+    int16_t vx = 0, vy = 0, vz = 0;
+    uint16_t voltage = 16200;
+
+    for(int i = 0 ; i < SYNTHETIC_MESSAGES ; i++)
+    {
+        timeMS += 50 + (random() % 20);
+        roll += 0.01f * drift(random);
+        pitch += 0.01f * drift(random);
+        yaw += 0.005f * drift(random);
+        vx = (int16_t)(vx + 5 * drift(random));
+        vy = (int16_t)(vy + 5 * drift(random));
+        vz = (int16_t)(vz + 2 * drift(random));
+        lat += vx / 10;
+        lon += vy / 10;
+        alt += vz / 10;
+
+        switch(i % 4)
+        {
+        case 0:
+            // HEARTBEAT
+            payloads.push_back(writer.Put<uint32_t>(0).Put<uint8_t>(2).Put<uint8_t>(3).Put<uint8_t>(0x81).Put<uint8_t>(4).Put<uint8_t>(3).Put<uint8_t>(3).Finish(0));
+            break;
+        case 1:
+            // SYS_STATUS
+            if(i % 40 == 1)
+            {
+                voltage -= 1;
+            }
+            payloads.push_back(writer.Put<uint32_t>(0x3FFFFF).Put<uint32_t>(0x3FFFFF).Put<uint32_t>(0x3FFFFF).Put<uint16_t>(350)
+                               .Put<uint16_t>(voltage).Put<int16_t>(1200 + (int16_t)(20 * drift(random))).Put<uint16_t>(0).Put<uint16_t>(0)
+                               .Put<uint16_t>(0).Put<uint16_t>(0).Put<uint16_t>(0).Put<uint16_t>(0).Put<int8_t>(87).Finish(1));
+            break;
+        case 2:
+            // ATTITUDE
+            payloads.push_back(writer.Put<uint32_t>(timeMS).Put<float>(roll).Put<float>(pitch).Put<float>(yaw)
+                               .Put<float>(0.01f * drift(random)).Put<float>(0.01f * drift(random)).Put<float>(0.01f * drift(random)).Finish(30));
+            break;
+        case 3:
+            // GLOBAL_POSITION_INT
+            payloads.push_back(writer.Put<uint32_t>(timeMS).Put<int32_t>(lat).Put<int32_t>(lon).Put<int32_t>(alt).Put<int32_t>(alt - 100000)
+                               .Put<int16_t>(vx).Put<int16_t>(vy).Put<int16_t>(vz).Put<uint16_t>((uint16_t)(yaw * 5729.6f)).Finish(33));
+            break;
+        }
+    }
+}
+
+
+static void run(const char *name, const LZCompressor &codec, const std::vector<std::vector<uint8_t>> &payloads, size_t first)
+{
+    size_t inBytes = 0;
+    size_t outBytes = 0;
+    size_t compressed = 0;
+    size_t messages = payloads.size() - first;
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> unpacked;
+
+    // sizes on the air, a payload that doesn't shrink goes out as it is
+    for(size_t i = first ; i < payloads.size() ; i++)
+    {
+        const std::vector<uint8_t> &payload = payloads[i];
+        inBytes += payload.size();
+        if(codec.Compress(payload.data(), payload.size(), packed))
+        {
+            if(!codec.Decompress(packed.data(), packed.size(), unpacked) || unpacked != payload)
+            {
+                std::cerr << name << ": message " << i << " did not survive a round trip" << std::endl;
+                exit(1);
+            }
+            outBytes += packed.size();
+            compressed++;
+        }
+        else
+        {
+            outBytes += payload.size();
+        }
+    }
+
+    Clock::time_point start = Clock::now();
+    for(int round = 0 ; round < TIMING_ROUNDS ; round++)
+    {
+        for(size_t i = first ; i < payloads.size() ; i++)
+        {
+            codec.Compress(payloads[i].data(), payloads[i].size(), packed);
+        }
+    }
+    double compressUS = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / (TIMING_ROUNDS * messages);
+
+    std::vector<std::vector<uint8_t>> packedPayloads;
+    for(size_t i = first ; i < payloads.size() ; i++)
+    {
+        if(codec.Compress(payloads[i].data(), payloads[i].size(), packed))
+        {
+            packedPayloads.push_back(packed);
+        }
+    }
+    double decompressUS = 0;
+    if(packedPayloads.size() > 0)
+    {
+        start = Clock::now();
+        for(int round = 0 ; round < TIMING_ROUNDS ; round++)
+        {
+            for(const std::vector<uint8_t> &payload : packedPayloads)
+            {
+                codec.Decompress(payload.data(), payload.size(), unpacked);
+            }
+        }
+        decompressUS = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / (TIMING_ROUNDS * packedPayloads.size());
+    }
+
+    printf("  %-16s ratio %5.3f  %5.1f%% compressed  compress %6.2f us/msg  decompress %6.2f us/msg\n", name,
+           (double)outBytes / inBytes, 100.0 * compressed / messages, compressUS, decompressUS);
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::vector<uint8_t>> payloads;
+    if(argc > 1)
+    {
+        if(!read_payloads(argv[1], payloads))
+        {
+            std::cerr << "Could not read " << argv[1] << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        synthesize_payloads(payloads);
+    }
+
+    if(payloads.size() <= DICTIONARY_MESSAGES)
+    {
+        std::cerr << "Need more than " << DICTIONARY_MESSAGES << " payloads" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint8_t> dictionary;
+    size_t totalLength = 0;
+    for(size_t i = 0 ; i < payloads.size() ; i++)
+    {
+        totalLength += payloads[i].size();
+        if(i < DICTIONARY_MESSAGES)
+        {
+            dictionary.insert(dictionary.end(), payloads[i].begin(), payloads[i].end());
+        }
+    }
+
+    printf("%zu payloads from %s, mean length %.1f bytes, %zu byte dictionary\n", payloads.size() - DICTIONARY_MESSAGES,
+           argc > 1 ? argv[1] : "synthetic telemetry", (double)totalLength / payloads.size(), dictionary.size());
+    printf("  ratio is bytes on the air over bytes in, payloads that don't shrink are sent as they are\n");
+
+    run("no dictionary", LZCompressor(), payloads, DICTIONARY_MESSAGES);
+    run("dictionary", LZCompressor(dictionary, LZ_COMPRESSOR_ID + 1), payloads, DICTIONARY_MESSAGES);
+
+    return 0;
+}
@@ -0,0 +1,14 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+QT -= gui
+
+SOURCES += main.cpp
+
+INCLUDEPATH += $$PWD/../../
+
+INCLUDEPATH += $$PWD/../../DigiMesh
+DEPENDPATH += $$PWD/../../DigiMesh
+
+INCLUDEPATH += $$PWD/../../common
+DEPENDPATH += $$PWD/../../common
@@ -0,0 +1,264 @@
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <new>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "frame_encoder.h"
+#include "ring_buffer.h"
+#include "math_helper.h"
+#include "frame-persistance/behaviors/index.h"
+#include "frame-persistance/types/index.h"
+
+//
+// Encodes transmit request frames the way DigiMeshRadio did before FrameEncoder and the way it does now, and reports
+// frames/sec and heap allocations per frame for each.
+//
+// Neither path touches a port. Handing work to the link's thread is reproduced with an event object built the way
+// SerialLink::postToThread builds it, Qt's own bookkeeping for a posted event is not counted, so the counts for the
+// earlier path are a lower bound.
+//
+// The current path only posts a flush for the first frame written into an empty ring. The burst is how many frames
+// are encoded before the ring is drained, 1 posts a flush for every frame.
+//
+// Usage: encoder_throughput [frames] [payload bytes] [burst]
+//
+
+#define DEFAULT_FRAMES 1000000
+#define DEFAULT_PAYLOAD_LENGTH 64
+#define DEFAULT_BURST 1
+#define TRANSMIT_REQUEST_HEADER_LENGTH 14
+#define FRAME_TRANSMIT_REQUEST 0x10
+#define BENCH_RING_SIZE 8192
+
+typedef std::chrono::steady_clock Clock;
+
+static size_t s_Allocations = 0;
+
+void* operator new(size_t size)
+{
+    s_Allocations++;
+    void *ptr = malloc(size == 0 ? 1 : size);
+    if(ptr == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+
+//!
+//! \brief Stand in for the link's thread, posted events are run and destroyed as they are posted
+//!
+class Link
+{
+public:
+
+    std::mutex m_WriteMutex;
+    RingBuffer m_TransmitBuffer;
+    bool m_FlushPending;
+    uint64_t m_BytesWritten;
+
+    Link() :
+        m_TransmitBuffer(BENCH_RING_SIZE),
+        m_FlushPending(false),
+        m_BytesWritten(0)
+    {
+    }
+
+    void WriteBytes(const char *bytes, int length)
+    {
+        m_BytesWritten += length;
+    }
+
+    void MarshalOnThread(std::function<void()> func)
+    {
+        postToThread([func](){
+            func();
+        });
+    }
+
+    void Drain()
+    {
+        std::lock_guard<std::mutex> lock(m_WriteMutex);
+        m_BytesWritten += m_TransmitBuffer.Size();
+        m_TransmitBuffer.Clear();
+        m_FlushPending = false;
+    }
+
+private:
+
+    template <typename F>
+    static void postToThread(F && fun) {
+      struct Event {
+        F fun;
+        Event(F && fun) : fun(std::move(fun)) {}
+        virtual ~Event() {
+            fun();
+        }
+      };
+      delete new Event(std::move(fun));
+    }
+};
+
+
+//!
+//! \brief DigiMeshRadio::construct_message before FrameEncoder, sending without a status callback
+//!
+static void encode_previous(Link &link, const std::vector<uint8_t> &data, const uint64_t &addr)
+{
+    std::shared_ptr<FramePersistanceBehavior<ShutdownFirstResponse>> frameBehavior = std::make_shared<FramePersistanceBehavior<ShutdownFirstResponse>>(ShutdownFirstResponse());
+
+    int packet_length = 14 + data.size();
+    int total_length = packet_length+4;
+    char *tx_buf = new char[total_length];
+
+    int frame_id = 0;
+
+    tx_buf[0] = START_BYTE;
+    tx_buf[1] = (packet_length >> 8) & 0xFF;
+    tx_buf[2] = packet_length & 0xFF;
+    tx_buf[3] = FRAME_TRANSMIT_REQUEST;
+    tx_buf[4] = frame_id;
+    for(size_t i = 0 ; i < 8 ; i++) {
+        uint64_t a = (addr & (0xFFll << (8*(7-i)))) >> (8*(7-i));
+        tx_buf[5+i] = (char)a;
+    }
+    tx_buf[13] = 0xFF;
+    tx_buf[14] = 0xFe;
+    tx_buf[15] = 0x00;
+    tx_buf[16] = 0x00;
+    for(size_t i = 0 ; i < data.size() ; i++) {
+        tx_buf[17+i] = data.at(i);
+    }
+    tx_buf[total_length-1] = MathHelper::calc_checksum(tx_buf, 3, total_length-1);
+
+    link.MarshalOnThread([&link, tx_buf, total_length, frame_id, frameBehavior](){
+        link.WriteBytes(tx_buf, total_length);
+
+        delete[] tx_buf;
+    });
+}
+
+
+//!
+//! \brief DigiMeshRadio::transmit_message and SerialLink::WriteFrame, sending without a status callback
+//!
+static void encode_current(Link &link, const FrameEncoder &encoder, const std::vector<uint8_t> &data, const uint64_t &addr)
+{
+    uint8_t header[TRANSMIT_REQUEST_HEADER_LENGTH];
+    header[0] = FRAME_TRANSMIT_REQUEST;
+    header[1] = 0;
+    for(size_t i = 0 ; i < 8 ; i++) {
+        header[2+i] = (addr >> (8*(7-i))) & 0xFF;
+    }
+    header[10] = 0xFF;
+    header[11] = 0xFE;
+    header[12] = 0;
+    header[13] = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(link.m_WriteMutex);
+        encoder.Encode(link.m_TransmitBuffer, header, TRANSMIT_REQUEST_HEADER_LENGTH, data.data(), data.size());
+
+        if(link.m_FlushPending) {
+            return;
+        }
+        link.m_FlushPending = true;
+    }
+
+    // the flush itself runs when the ring is drained
+    link.MarshalOnThread([](){
+    });
+}
+
+
+static void report(const char *name, size_t frames, Clock::duration elapsed, size_t allocations)
+{
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    printf("  %-16s %12.0f frames/s  %6.2f allocations/frame\n", name, frames / seconds, (double)allocations / frames);
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t frames = DEFAULT_FRAMES;
+    size_t payloadLength = DEFAULT_PAYLOAD_LENGTH;
+    size_t burst = DEFAULT_BURST;
+    if(argc > 1)
+    {
+        frames = std::max(atoi(argv[1]), 1);
+    }
+    if(argc > 2)
+    {
+        payloadLength = std::max(atoi(argv[2]), 0);
+    }
+    if(argc > 3)
+    {
+        burst = std::max(atoi(argv[3]), 1);
+    }
+
+    std::vector<uint8_t> data(payloadLength);
+    for(size_t i = 0 ; i < data.size() ; i++)
+    {
+        data[i] = (uint8_t)i;
+    }
+    const uint64_t addr = 0x0013a200410545a1;
+
+    printf("%zu frames, %zu byte payload, burst of %zu\n", frames, payloadLength, burst);
+
+    Link link;
+    FrameEncoder encoder(APIModes::UNESCAPED);
+    size_t maxLength = encoder.MaxEncodedLength(TRANSMIT_REQUEST_HEADER_LENGTH + payloadLength);
+    if(maxLength * burst > BENCH_RING_SIZE)
+    {
+        std::cerr << "Burst does not fit in the transmit ring" << std::endl;
+        return 1;
+    }
+
+    // untimed pass so neither path pays for warming caches and the allocator
+    for(size_t i = 0 ; i < frames / 10 ; i++)
+    {
+        encode_previous(link, data, addr);
+        encode_current(link, encoder, data, addr);
+        link.Drain();
+    }
+
+    size_t allocations = s_Allocations;
+    Clock::time_point start = Clock::now();
+    for(size_t i = 0 ; i < frames ; i++)
+    {
+        encode_previous(link, data, addr);
+    }
+    report("new[] and post", frames, Clock::now() - start, s_Allocations - allocations);
+
+    allocations = s_Allocations;
+    start = Clock::now();
+    for(size_t i = 0 ; i < frames ; i++)
+    {
+        encode_current(link, encoder, data, addr);
+        if((i + 1) % burst == 0)
+        {
+            link.Drain();
+        }
+    }
+    link.Drain();
+    report("FrameEncoder", frames, Clock::now() - start, s_Allocations - allocations);
+
+    return 0;
+}
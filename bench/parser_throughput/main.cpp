@@ -0,0 +1,254 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <mutex>
+#include <functional>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "api_frame_parser.h"
+
+//
+// Feeds synthetic received streams through ApiFrameParser and through a copy of the buffering DigiMeshRadio used
+// before it, and reports the throughput of each.
+//
+// The clean stream is back to back receive packet frames. The corrupted stream has runs of noise between frames and
+// a flipped byte in some frames. Both are handed over in chunks, as the serial link would.
+//
+// Usage: parser_throughput [stream MiB] [chunk bytes]
+//
+
+#define DEFAULT_STREAM_MIB 4
+#define DEFAULT_CHUNK_LENGTH 64
+#define NOISE_PROBABILITY 0.3
+#define MAX_NOISE_LENGTH 32
+#define CORRUPT_PROBABILITY 0.05
+
+typedef std::chrono::steady_clock Clock;
+
+
+//!
+//! \brief The buffering DigiMeshRadio::ReceiveData used before ApiFrameParser
+//!
+//! Bytes are appended to a vector, garbage is erased from the front one byte at a time and every frame is erased from
+//! the front once copied out.
+//!
+class LegacyParser
+{
+private:
+
+    std::vector<uint8_t> m_CurrBuf;
+    std::mutex m_CurrBuffMutex;
+    std::function<void(const std::vector<uint8_t> &)> m_FrameCallback;
+
+public:
+
+    void SetFrameCallback(const std::function<void(const std::vector<uint8_t> &)> &func)
+    {
+        m_FrameCallback = func;
+    }
+
+    void Parse(const uint8_t *buffer, size_t length)
+    {
+        m_CurrBuffMutex.lock();
+        for(size_t i = 0 ; i < length ; i++) {
+            m_CurrBuf.push_back(buffer[i]);
+        }
+        m_CurrBuffMutex.unlock();
+
+        while(true) {
+
+            m_CurrBuffMutex.lock();
+
+            if(m_CurrBuf.size() < 3) {
+                m_CurrBuffMutex.unlock();
+                break;
+            }
+
+            if(m_CurrBuf.at(0) != 0x7E) {
+                m_CurrBuf.erase(m_CurrBuf.begin());
+                m_CurrBuffMutex.unlock();
+                continue;
+            }
+
+            uint16_t packet_length = (((uint16_t)m_CurrBuf[1])<<8 | (uint16_t)m_CurrBuf[2]) + 4;
+
+            if(m_CurrBuf.size() < packet_length) {
+                m_CurrBuffMutex.unlock();
+                return;
+            }
+
+            std::vector<uint8_t> packet(
+                std::make_move_iterator(m_CurrBuf.begin() + 3),
+                std::make_move_iterator(m_CurrBuf.begin() + packet_length - 1));
+            uint8_t checksum = m_CurrBuf.at(packet_length -1);
+
+            m_CurrBuf.erase(m_CurrBuf.begin(), m_CurrBuf.begin() + packet_length);
+
+            m_CurrBuffMutex.unlock();
+
+            uint8_t dataCheck = checksum;
+            for(auto it = packet.cbegin() ; it != packet.cend() ; ++it)
+            {
+                dataCheck += *it;
+            }
+            if(dataCheck != 0xFF)
+            {
+                printf("Digimesh Checksum Failed! Ignoring packet.\n");
+                continue;
+            }
+
+            m_FrameCallback(packet);
+        }
+    }
+};
+
+
+//!
+//! \brief Silences stdout while in scope, both parsers print a line per checksum failure
+//!
+class QuietStdout
+{
+private:
+
+    int m_Saved;
+
+public:
+
+    QuietStdout()
+    {
+        fflush(stdout);
+        m_Saved = dup(STDOUT_FILENO);
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        close(devNull);
+    }
+
+    ~QuietStdout()
+    {
+        fflush(stdout);
+        dup2(m_Saved, STDOUT_FILENO);
+        close(m_Saved);
+    }
+};
+
+
+//!
+//! \brief Append a receive packet frame (0x90) carrying a random payload
+//!
+static void append_frame(std::vector<uint8_t> &stream, std::mt19937 &random, bool corrupt)
+{
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<int> payloadLength(16, 100);
+
+    std::vector<uint8_t> frame = {0x90, 0x00, 0x13, 0xa2, 0x00, 0x41, 0x05, 0x45, 0xa1, 0xff, 0xfe, 0xc2};
+    int length = payloadLength(random);
+    for(int i = 0 ; i < length ; i++)
+    {
+        frame.push_back(byte(random));
+    }
+
+    uint8_t sum = 0;
+    for(uint8_t b : frame)
+    {
+        sum += b;
+    }
+
+    stream.push_back(0x7e);
+    stream.push_back((frame.size() >> 8) & 0xFF);
+    stream.push_back(frame.size() & 0xFF);
+    size_t bodyStart = stream.size();
+    stream.insert(stream.end(), frame.begin(), frame.end());
+    stream.push_back(0xFF - sum);
+
+    if(corrupt)
+    {
+        std::uniform_int_distribution<size_t> position(bodyStart, stream.size() - 2);
+        stream[position(random)] ^= 0x01;
+    }
+}
+
+
+static std::vector<uint8_t> make_stream(size_t length, bool noisy)
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<int> noiseLength(1, MAX_NOISE_LENGTH);
+    std::uniform_int_distribution<int> byte(0, 255);
+
+    std::vector<uint8_t> stream;
+    stream.reserve(length + 256);
+    while(stream.size() < length)
+    {
+        if(noisy && chance(random) < NOISE_PROBABILITY)
+        {
+            int count = noiseLength(random);
+            for(int i = 0 ; i < count ; i++)
+            {
+                stream.push_back(byte(random));
+            }
+        }
+        append_frame(stream, random, noisy && chance(random) < CORRUPT_PROBABILITY);
+    }
+    return stream;
+}
+
+
+template <typename P>
+static void run(const char *name, P &parser, const std::vector<uint8_t> &stream, size_t chunkLength)
+{
+    size_t frames = 0;
+    parser.SetFrameCallback([&frames](const std::vector<uint8_t> &frame){
+        frames++;
+    });
+
+    Clock::time_point start;
+    Clock::time_point end;
+    {
+        QuietStdout quiet;
+        start = Clock::now();
+        for(size_t offset = 0 ; offset < stream.size() ; offset += chunkLength)
+        {
+            parser.Parse(stream.data() + offset, std::min(chunkLength, stream.size() - offset));
+        }
+        end = Clock::now();
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("  %-16s %9.1f MiB/s  %9zu frames\n", name, stream.size() / seconds / (1024.0 * 1024.0), frames);
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t streamLength = DEFAULT_STREAM_MIB * 1024 * 1024;
+    size_t chunkLength = DEFAULT_CHUNK_LENGTH;
+    if(argc > 1)
+    {
+        streamLength = std::max(atoi(argv[1]), 1) * 1024 * 1024;
+    }
+    if(argc > 2)
+    {
+        chunkLength = std::max(atoi(argv[2]), 1);
+    }
+
+    const bool noisy[] = {false, true};
+    for(bool isNoisy : noisy)
+    {
+        std::vector<uint8_t> stream = make_stream(streamLength, isNoisy);
+        printf("%s stream, %zu bytes in %zu byte chunks\n", isNoisy ? "Corrupted" : "Clean", stream.size(), chunkLength);
+
+        ApiFrameParser parser;
+        run("ApiFrameParser", parser, stream, chunkLength);
+
+        LegacyParser legacy;
+        run("erase from front", legacy, stream, chunkLength);
+    }
+
+    return 0;
+}
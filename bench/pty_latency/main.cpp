@@ -0,0 +1,323 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <QCoreApplication>
+#include <QSerialPort>
+#include <QThread>
+#include <QTimer>
+
+#include "serial_link.h"
+#include "i_link_events.h"
+
+//
+// Measures how long a byte written to one end of a pty pair takes to reach the reader on the other end.
+//
+// The event driven reader is SerialLink itself. The polling reader reproduces the reader SerialLink used before,
+// a QTimer on the port's thread checking bytesAvailable() every 10 ms.
+//
+// Usage: pty_latency [samples]
+//
+
+#define DEFAULT_SAMPLES 200
+#define POLL_INTERVAL_MS 10
+#define ARRIVAL_TIMEOUT_MS 1000
+
+typedef std::chrono::steady_clock Clock;
+
+
+//!
+//! \brief Hands the time a probe byte was read from the reader's thread to the writer
+//!
+class Arrival
+{
+private:
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_Arrived;
+    Clock::time_point m_Time;
+
+public:
+
+    Arrival() :
+        m_Arrived(false)
+    {
+    }
+
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Arrived = false;
+    }
+
+    void Notify()
+    {
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if(m_Arrived == false)
+        {
+            m_Arrived = true;
+            m_Time = now;
+        }
+        m_Condition.notify_all();
+    }
+
+    bool Wait(Clock::time_point &time)
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if(!m_Condition.wait_for(lock, std::chrono::milliseconds(ARRIVAL_TIMEOUT_MS), [this](){return m_Arrived;}))
+        {
+            return false;
+        }
+        time = m_Time;
+        return true;
+    }
+};
+
+
+class LinkListener : public ILinkEvents
+{
+private:
+
+    Arrival *m_Arrival;
+
+public:
+
+    LinkListener(Arrival *arrival) :
+        m_Arrival(arrival)
+    {
+    }
+
+    virtual void ReceiveData(SerialLink *link_ptr, const uint8_t *buffer, size_t length)
+    {
+        m_Arrival->Notify();
+    }
+
+    virtual void CommunicationError(const SerialLink* link_ptr, const std::string &type, const std::string &msg)
+    {
+        std::cerr << type << ": " << msg << std::endl;
+    }
+
+    virtual void CommunicationUpdate(const SerialLink *link_ptr, const std::string &name, const std::string &msg)
+    {
+    }
+
+    virtual void Connected(const SerialLink* link_ptr)
+    {
+    }
+
+    virtual void ConnectionRemoved(const SerialLink *link_ptr)
+    {
+    }
+};
+
+
+//!
+//! \brief The reader SerialLink used before it was driven by readyRead
+//!
+class PollingReader : public QThread
+{
+private:
+
+    std::string m_PortName;
+    Arrival *m_Arrival;
+    std::atomic<bool> m_Opened;
+
+public:
+
+    PollingReader(const std::string &portName, Arrival *arrival) :
+        m_PortName(portName),
+        m_Arrival(arrival),
+        m_Opened(false)
+    {
+    }
+
+    bool Opened() const
+    {
+        return m_Opened;
+    }
+
+    virtual void run()
+    {
+        QSerialPort port(QString::fromStdString(m_PortName));
+        if(!port.open(QIODevice::ReadWrite))
+        {
+            return;
+        }
+        m_Opened = true;
+
+        QTimer timer;
+        QObject::connect(&timer, &QTimer::timeout, &port, [&port, this](){
+            if(port.bytesAvailable())
+            {
+                port.readAll();
+                m_Arrival->Notify();
+            }
+        });
+        timer.start(POLL_INTERVAL_MS);
+
+        exec();
+    }
+};
+
+
+static int open_pty(std::string &slaveName)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0)
+    {
+        return -1;
+    }
+    if(grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        close(master);
+        return -1;
+    }
+    slaveName = ptsname(master);
+    return master;
+}
+
+
+//!
+//! \brief Write probe bytes to the master end and collect the time each took to be read
+//!
+//! Probes are spaced by a random gap longer than the poll interval, so they land at every phase of the poll timer.
+//!
+static bool measure(int master, Arrival &arrival, int samples, std::vector<double> &latencies)
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> gap(POLL_INTERVAL_MS * 1000, 3 * POLL_INTERVAL_MS * 1000);
+    const uint8_t probe = 0x7e;
+
+    latencies.clear();
+    for(int i = 0 ; i < samples ; i++)
+    {
+        arrival.Reset();
+        Clock::time_point sent = Clock::now();
+        if(write(master, &probe, 1) != 1)
+        {
+            return false;
+        }
+
+        Clock::time_point received;
+        if(!arrival.Wait(received))
+        {
+            return false;
+        }
+        latencies.push_back(std::chrono::duration<double, std::micro>(received - sent).count());
+
+        std::this_thread::sleep_for(std::chrono::microseconds(gap(random)));
+    }
+    return true;
+}
+
+
+static void report(const char *name, std::vector<double> latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    double sum = 0;
+    for(double latency : latencies)
+    {
+        sum += latency;
+    }
+
+    printf("%-14s mean %9.1f us  median %9.1f us  p99 %9.1f us  max %9.1f us\n", name,
+           sum / latencies.size(),
+           latencies[latencies.size() / 2],
+           latencies[(latencies.size() * 99) / 100],
+           latencies.back());
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int samples = DEFAULT_SAMPLES;
+    if(argc > 1)
+    {
+        samples = std::max(atoi(argv[1]), 1);
+    }
+
+    std::string slaveName;
+    int master = open_pty(slaveName);
+    if(master < 0)
+    {
+        std::cerr << "Could not open a pty pair" << std::endl;
+        return 1;
+    }
+
+    Arrival arrival;
+    std::vector<double> latencies;
+
+    // event driven, the current SerialLink
+    {
+        SerialConfiguration config;
+        config.setBaud(DigiMeshBaudRates::Baud9600);
+        config.setPortName(slaveName);
+        config.setDataBits(8);
+        config.setParity(QSerialPort::NoParity);
+        config.setStopBits(1);
+        config.setFlowControl(QSerialPort::NoFlowControl);
+
+        LinkListener listener(&arrival);
+        SerialLink link(config);
+        link.AddListener(&listener);
+        if(!link.Connect())
+        {
+            std::cerr << "Could not open " << slaveName << std::endl;
+            return 1;
+        }
+
+        if(!measure(master, arrival, samples, latencies))
+        {
+            std::cerr << "Probe byte never arrived through SerialLink" << std::endl;
+            return 1;
+        }
+        link.Disconnect();
+    }
+    report("event driven", latencies);
+
+    // polling every POLL_INTERVAL_MS, the previous SerialLink
+    {
+        PollingReader reader(slaveName, &arrival);
+        reader.start();
+        while(!reader.Opened() && !reader.isFinished())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if(!reader.Opened())
+        {
+            reader.wait();
+            std::cerr << "Could not open " << slaveName << std::endl;
+            return 1;
+        }
+
+        bool ok = measure(master, arrival, samples, latencies);
+        reader.quit();
+        reader.wait();
+
+        if(!ok)
+        {
+            std::cerr << "Probe byte never arrived through the polling reader" << std::endl;
+            return 1;
+        }
+    }
+    report("polling", latencies);
+
+    close(master);
+    return 0;
+}
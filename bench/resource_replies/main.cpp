@@ -0,0 +1,247 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <QCoreApplication>
+
+#include "interop_component.h"
+#include "api_frame_parser.h"
+
+//
+// Answers a contained resource request with a node holding many resources, once in the legacy encoding and once in
+// the v2 encoding, and counts the frames the reply takes in each.
+//
+// The node is a real InteropComponent on one end of a pty pair. The request is written to the other end as a receive
+// packet frame and every transmit request the node writes back is decoded. Legacy replies take one frame per resource,
+// that format has no entry boundaries. v2 replies are batched up to the radio's maximum payload, 73 bytes as the pty
+// never answers the NP query, after a NAME_DEFINITIONS frame for names not defined yet.
+//
+// Exits with a failure if the v2 reply is not batched into fewer frames than the legacy one.
+//
+// Usage: resource_replies [resources]
+//
+
+#define DEFAULT_RESOURCES 20
+#define QUIET_MS 1000
+#define FRAME_TRANSMIT_REQUEST 0x10
+#define TRANSMIT_REQUEST_HEADER_LENGTH 14
+#define COMPONENT_ITEM_PRESENT 0x02
+#define CONTAINED_VECHILES_REQUEST 0x03
+#define COMPONENT_ITEM_PRESENT_V2 0x0A
+#define NAME_DEFINITIONS 0x0C
+
+
+struct ReplyCounts
+{
+    size_t legacyFrames;
+    size_t v2Frames;
+    size_t nameFrames;
+    size_t bytes;
+
+    ReplyCounts() :
+        legacyFrames(0),
+        v2Frames(0),
+        nameFrames(0),
+        bytes(0)
+    {
+    }
+};
+
+
+//!
+//! \brief InteropComponent with its resources added from outside, as the MACE wrapper adds them
+//!
+class Node : public InteropComponent
+{
+public:
+
+    Node(const std::string &port) :
+        InteropComponent(port, DigiMeshBaudRates::Baud9600)
+    {
+    }
+
+    using InteropComponent::AddResource;
+};
+
+
+static int open_pty(std::string &slaveName)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if(master < 0)
+    {
+        return -1;
+    }
+    if(grantpt(master) != 0 || unlockpt(master) != 0)
+    {
+        close(master);
+        return -1;
+    }
+    slaveName = ptsname(master);
+    return master;
+}
+
+
+//!
+//! \brief Write an API frame to the master end, escaped as the node expects
+//!
+static bool write_frame(int master, const std::vector<uint8_t> &frame)
+{
+    uint8_t checksum = 0;
+    for(uint8_t b : frame)
+    {
+        checksum += b;
+    }
+
+    std::vector<uint8_t> unescaped = {(uint8_t)((frame.size() >> 8) & 0xFF), (uint8_t)(frame.size() & 0xFF)};
+    unescaped.insert(unescaped.end(), frame.begin(), frame.end());
+    unescaped.push_back(0xFF - checksum);
+
+    std::vector<uint8_t> bytes = {0x7E};
+    for(uint8_t b : unescaped)
+    {
+        if(b == 0x7E || b == 0x7D || b == 0x11 || b == 0x13)
+        {
+            bytes.push_back(0x7D);
+            bytes.push_back(b ^ 0x20);
+        }
+        else
+        {
+            bytes.push_back(b);
+        }
+    }
+    return write(master, bytes.data(), bytes.size()) == (ssize_t)bytes.size();
+}
+
+
+//!
+//! \brief Read from the master end until nothing arrives for QUIET_MS, counting the resource frames written
+//!
+static ReplyCounts collect(int master, ApiFrameParser &parser)
+{
+    ReplyCounts counts;
+    parser.SetFrameCallback([&counts](const std::vector<uint8_t> &frame){
+        if(frame.size() <= TRANSMIT_REQUEST_HEADER_LENGTH || frame[0] != FRAME_TRANSMIT_REQUEST)
+        {
+            return;
+        }
+        switch(frame[TRANSMIT_REQUEST_HEADER_LENGTH])
+        {
+        case COMPONENT_ITEM_PRESENT:
+            counts.legacyFrames++;
+            break;
+        case COMPONENT_ITEM_PRESENT_V2:
+            counts.v2Frames++;
+            break;
+        case NAME_DEFINITIONS:
+            counts.nameFrames++;
+            break;
+        default:
+            return;
+        }
+        counts.bytes += frame.size() - TRANSMIT_REQUEST_HEADER_LENGTH;
+    });
+
+    uint8_t buffer[256];
+    pollfd fd = {master, POLLIN, 0};
+    while(poll(&fd, 1, QUIET_MS) > 0)
+    {
+        ssize_t length = read(master, buffer, sizeof(buffer));
+        if(length <= 0)
+        {
+            break;
+        }
+        parser.Parse(buffer, length);
+    }
+    return counts;
+}
+
+
+static bool request_resources(int master)
+{
+    // receive packet frame broadcast by another node, its payload asking for every "vehicle"
+    std::vector<uint8_t> frame = {0x90, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xFF, 0xFE, 0x02};
+    frame.push_back(CONTAINED_VECHILES_REQUEST);
+    std::string name = "vehicle";
+    frame.insert(frame.end(), name.begin(), name.end());
+    frame.push_back('\0');
+    return write_frame(master, frame);
+}
+
+
+static void report(const char *name, const ReplyCounts &counts)
+{
+    printf("  %-8s %4zu COMPONENT_ITEM_PRESENT  %4zu COMPONENT_ITEM_PRESENT_V2  %4zu NAME_DEFINITIONS  %6zu payload bytes\n",
+           name, counts.legacyFrames, counts.v2Frames, counts.nameFrames, counts.bytes);
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int resources = DEFAULT_RESOURCES;
+    if(argc > 1)
+    {
+        resources = std::max(atoi(argv[1]), 2);
+    }
+
+    std::string slaveName;
+    int master = open_pty(slaveName);
+    if(master < 0)
+    {
+        std::cerr << "Could not open a pty pair" << std::endl;
+        return 1;
+    }
+
+    ApiFrameParser parser;
+    parser.SetMode(APIModes::ESCAPED);
+
+    Node node(slaveName);
+    node.SetResponseJitter(0);
+    for(int i = 0 ; i < resources ; i++)
+    {
+        ResourceKey key;
+        key.AddNameToResourceKey("vehicle");
+        ResourceValue value;
+        value.AddValueToResourceKey(i + 1);
+        node.AddResource(key, value);
+    }
+    // the announcements and the AT commands sent on startup
+    collect(master, parser);
+
+    printf("Reply to a contained resource request from a node holding %d resources\n", resources);
+
+    node.SetLegacyResourceEncoding(true);
+    if(!request_resources(master))
+    {
+        std::cerr << "Could not write the request" << std::endl;
+        return 1;
+    }
+    ReplyCounts legacy = collect(master, parser);
+    report("legacy", legacy);
+
+    node.SetLegacyResourceEncoding(false);
+    if(!request_resources(master))
+    {
+        std::cerr << "Could not write the request" << std::endl;
+        return 1;
+    }
+    ReplyCounts v2 = collect(master, parser);
+    report("v2", v2);
+
+    close(master);
+
+    if(legacy.legacyFrames != (size_t)resources || v2.v2Frames == 0 || v2.v2Frames >= legacy.legacyFrames)
+    {
+        std::cerr << "v2 reply was not batched" << std::endl;
+        return 1;
+    }
+    return 0;
+}
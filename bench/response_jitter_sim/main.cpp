@@ -0,0 +1,189 @@
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <random>
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "interop.h"
+
+//
+// Simulates a broadcast contained resource request answered by every other node of a mesh, and counts how the
+// replies fare on a shared channel with and without the response jitter Interop applies.
+//
+// Every node hears the request within a short spread (the mesh rebroadcasting it), waits for its reply delay and
+// then contends for the channel with a simple CSMA model: a node that senses the channel busy backs off for a random
+// number of backoff periods, doubling the range each time, and gives up after MAX_CCA_ATTEMPTS, which the radio
+// reports as COLLISION_AVOIDANCE_FAILURE. Nodes starting within CCA_BLIND_MS of each other can't sense one another and
+// collide, and replies are broadcasts so a collided reply is lost.
+//
+// The reply delay is drawn exactly as Interop::reply_contained_resources draws it, the known node count is the only
+// input. "cold" is a responder that has heard from no other node yet, "warm" one that has heard from all of them.
+// Every node holds distinct items, so suppressing items another node already announced never applies here.
+//
+// Usage: response_jitter_sim [nodes] [trials] [RF kbps]
+//
+
+#define DEFAULT_NODES 50
+#define DEFAULT_TRIALS 1000
+#define DEFAULT_RF_KBPS 200
+#define REPLY_BYTES 60
+#define REQUEST_SPREAD_MS 5.0
+#define CCA_BLIND_MS 0.5
+#define BACKOFF_PERIOD_MS 1.0
+#define MIN_BACKOFF_EXPONENT 3
+#define MAX_BACKOFF_EXPONENT 5
+#define MAX_CCA_ATTEMPTS 5
+
+
+struct Transmission
+{
+    double start;
+    double end;
+};
+
+struct Attempt
+{
+    double time;
+    int node;
+    int attempts;
+
+    bool operator>(const Attempt &rhs) const
+    {
+        return time > rhs.time;
+    }
+};
+
+struct Totals
+{
+    double ccaFailures;
+    double collided;
+    double lastReplyMS;
+
+    Totals() :
+        ccaFailures(0),
+        collided(0),
+        lastReplyMS(0)
+    {
+    }
+};
+
+
+//!
+//! \brief Reply delay in ms, as drawn by Interop::reply_contained_resources
+//!
+static int reply_delay(std::mt19937 &random, int slotMS, int maxDelayMS, size_t knownNodes)
+{
+    if(slotMS <= 0)
+    {
+        return 0;
+    }
+    int window = std::min<long long>((long long)slotMS * (knownNodes + 1), maxDelayMS);
+    return std::uniform_int_distribution<int>(0, std::max(window, 0))(random);
+}
+
+
+static void simulate(std::mt19937 &random, int nodes, double airMS, int slotMS, size_t knownNodes, Totals &totals)
+{
+    std::uniform_real_distribution<double> spread(0.0, REQUEST_SPREAD_MS);
+    std::priority_queue<Attempt, std::vector<Attempt>, std::greater<Attempt>> attempts;
+    for(int node = 0 ; node < nodes ; node++)
+    {
+        double heard = spread(random);
+        attempts.push({heard + reply_delay(random, slotMS, DEFAULT_MAX_RESPONSE_DELAY_MS, knownNodes), node, 0});
+    }
+
+    std::vector<Transmission> channel;
+    while(!attempts.empty())
+    {
+        Attempt attempt = attempts.top();
+        attempts.pop();
+
+        bool busy = false;
+        for(const Transmission &transmission : channel)
+        {
+            if(transmission.start + CCA_BLIND_MS <= attempt.time && attempt.time < transmission.end)
+            {
+                busy = true;
+                break;
+            }
+        }
+
+        if(!busy)
+        {
+            channel.push_back({attempt.time, attempt.time + airMS});
+            continue;
+        }
+
+        attempt.attempts++;
+        if(attempt.attempts >= MAX_CCA_ATTEMPTS)
+        {
+            totals.ccaFailures++;
+            continue;
+        }
+        int exponent = std::min(MIN_BACKOFF_EXPONENT + attempt.attempts - 1, MAX_BACKOFF_EXPONENT);
+        int periods = std::uniform_int_distribution<int>(0, (1 << exponent) - 1)(random);
+        attempt.time += periods * BACKOFF_PERIOD_MS;
+        attempts.push(attempt);
+    }
+
+    double last = 0;
+    for(size_t i = 0 ; i < channel.size() ; i++)
+    {
+        last = std::max(last, channel[i].end);
+        for(size_t j = 0 ; j < channel.size() ; j++)
+        {
+            if(i != j && channel[i].start < channel[j].end && channel[j].start < channel[i].end)
+            {
+                totals.collided++;
+                break;
+            }
+        }
+    }
+    totals.lastReplyMS += last;
+}
+
+
+static void run(const char *name, int nodes, int trials, double airMS, int slotMS, size_t knownNodes)
+{
+    std::mt19937 random(1);
+    Totals totals;
+    for(int trial = 0 ; trial < trials ; trial++)
+    {
+        simulate(random, nodes, airMS, slotMS, knownNodes, totals);
+    }
+
+    printf("  %-22s %7.2f CCA failures  %7.2f collided replies  %8.1f ms until the last reply\n", name,
+           totals.ccaFailures / trials, totals.collided / trials, totals.lastReplyMS / trials);
+}
+
+
+int main(int argc, char *argv[])
+{
+    int nodes = DEFAULT_NODES;
+    int trials = DEFAULT_TRIALS;
+    double kbps = DEFAULT_RF_KBPS;
+    if(argc > 1)
+    {
+        nodes = std::max(atoi(argv[1]), 1);
+    }
+    if(argc > 2)
+    {
+        trials = std::max(atoi(argv[2]), 1);
+    }
+    if(argc > 3)
+    {
+        kbps = std::max(atof(argv[3]), 1.0);
+    }
+
+    double airMS = REPLY_BYTES * 8 / kbps;
+    printf("%d responders, %d trials, %.0f kbps, %.2f ms per reply on the air, means per request\n", nodes, trials, kbps, airMS);
+
+    run("no jitter", nodes, trials, airMS, 0, 0);
+    run("jitter, cold", nodes, trials, airMS, DEFAULT_RESPONSE_SLOT_MS, 0);
+    run("jitter, warm", nodes, trials, airMS, DEFAULT_RESPONSE_SLOT_MS, nodes - 1);
+
+    return 0;
+}
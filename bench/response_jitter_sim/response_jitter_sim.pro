@@ -0,0 +1,15 @@
+TEMPLATE = app
+CONFIG += console c++11
+CONFIG -= app_bundle
+QT -= gui
+
+SOURCES += main.cpp
+
+INCLUDEPATH += $$PWD/../../DigiMesh
+DEPENDPATH += $$PWD/../../DigiMesh
+
+INCLUDEPATH += $$PWD/../../MACEDigiMeshWrapper
+DEPENDPATH += $$PWD/../../MACEDigiMeshWrapper
+
+INCLUDEPATH += $$PWD/../../common
+DEPENDPATH += $$PWD/../../common
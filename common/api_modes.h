@@ -0,0 +1,15 @@
+#ifndef API_MODES_H
+#define API_MODES_H
+
+//!
+//! \brief API operating modes of the radio (the AP parameter)
+//!
+//! In escaped mode the bytes 0x7E, 0x7D, 0x11 and 0x13 never appear inside a frame, they are sent as 0x7D followed by
+//! the byte XOR 0x20. A raw 0x7E therefore always marks the start of a frame.
+//!
+enum class APIModes {
+    UNESCAPED = 1,
+    ESCAPED = 2
+};
+
+#endif // API_MODES_H
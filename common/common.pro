@@ -27,7 +27,11 @@ SOURCES +=
 HEADERS += \
     digi_mesh_baud_rates.h \
     transmit_status_types.h \
-    discovery_status_types.h
+    discovery_status_types.h \
+    api_modes.h \
+    transmit_priority.h \
+    transmit_options.h \
+    route_information.h
 
 
 #copydata.commands = $(MKDIR) $$PWD/../include ; $(COPY_DIR) $$PWD/*.h $$PWD/../include/
@@ -0,0 +1,40 @@
+#ifndef ROUTE_INFORMATION_H
+#define ROUTE_INFORMATION_H
+
+#include <stdint.h>
+
+//!
+//! \brief What caused a radio to report a route information frame
+//!
+enum class RouteInformationEvents
+{
+    //! A hop did not acknowledge a unicast and the route is being repaired
+    NACK = 0x11,
+    //! A unicast sent with TransmitOptions::traceRoute was relayed by a hop
+    TRACE_ROUTE = 0x12
+};
+
+//!
+//! \brief One hop of a unicast, as reported by a route information frame (0x8D)
+//!
+//! A unicast sent with trace route produces one of these per hop. They carry no frame id, the destination and source
+//! addresses tell which message a hop belongs to.
+//!
+struct RouteInformation
+{
+    RouteInformationEvents sourceEvent;
+    //! Time the hop was made, in microseconds on the reporting radio's clock
+    uint32_t timestamp;
+    //! Times the hop timed out waiting on an acknowledgement
+    uint8_t ackTimeouts;
+    //! Times the hop was held back by clear channel assessment or the radio being busy
+    uint8_t transmitBlocked;
+    uint64_t destination;
+    uint64_t source;
+    //! Node that relayed the message on this hop
+    uint64_t responder;
+    //! Node that received the message on this hop
+    uint64_t receiver;
+};
+
+#endif // ROUTE_INFORMATION_H
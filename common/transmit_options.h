@@ -0,0 +1,82 @@
+#ifndef TRANSMIT_OPTIONS_H
+#define TRANSMIT_OPTIONS_H
+
+#include <stdint.h>
+#include <chrono>
+
+//!
+//! \brief How a transmit request is delivered, as encoded in bits 6 and 7 of its transmit options
+//!
+enum class DeliveryMethod
+{
+    //! Use the radio's TO parameter
+    DEFAULT = 0x00,
+    POINT_MULTIPOINT = 0x40,
+    REPEATER = 0x80,
+    DIGIMESH = 0xC0
+};
+
+//!
+//! \brief Options of a single transmit request, the defaults leave everything to the radio's configuration
+//!
+struct TransmitOptions
+{
+    //! Most hops a broadcast travels, 0 uses the network's maximum
+    uint8_t broadcastRadius;
+    //! Send without waiting on acknowledgements or retrying
+    bool disableAck;
+    //! Fail rather than discover a route when none is known
+    bool disableRouteDiscovery;
+    //! Have every hop of a unicast report a route information frame, passed to the handlers added with
+    //! DigiMeshRadio::AddRouteInformationHandler or Interop::AddHandler_RouteInformation
+    bool traceRoute;
+    DeliveryMethod deliveryMethod;
+    //! Nonzero to replace a message to the same address with the same key that is still waiting in the transmit
+    //! queue, whose callback is then notified with TransmitStatusTypes::SUPERSEDED
+    uint64_t coalesceKey;
+    //! Nonzero to drop the message, notifying its callback with TransmitStatusTypes::EXPIRED, if it is still waiting
+    //! in the transmit queue this long after being sent
+    std::chrono::milliseconds timeToLive;
+
+    TransmitOptions() :
+        broadcastRadius(0),
+        disableAck(false),
+        disableRouteDiscovery(false),
+        traceRoute(false),
+        deliveryMethod(DeliveryMethod::DEFAULT),
+        coalesceKey(0),
+        timeToLive(0)
+    {
+
+    }
+
+    //!
+    //! \brief Transmit options field of a transmit request frame
+    //!
+    uint8_t OptionsByte() const
+    {
+        uint8_t options = (uint8_t)deliveryMethod;
+        if(disableAck) {
+            options |= 0x01;
+        }
+        if(disableRouteDiscovery) {
+            options |= 0x02;
+        }
+        if(traceRoute) {
+            options |= 0x08;
+        }
+        return options;
+    }
+
+    bool operator==(const TransmitOptions &rhs) const
+    {
+        return broadcastRadius == rhs.broadcastRadius && OptionsByte() == rhs.OptionsByte() && coalesceKey == rhs.coalesceKey && timeToLive == rhs.timeToLive;
+    }
+
+    bool operator!=(const TransmitOptions &rhs) const
+    {
+        return !(*this == rhs);
+    }
+};
+
+#endif // TRANSMIT_OPTIONS_H
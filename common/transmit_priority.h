@@ -0,0 +1,16 @@
+#ifndef TRANSMIT_PRIORITY_H
+#define TRANSMIT_PRIORITY_H
+
+#define NUM_TRANSMIT_PRIORITIES 3
+
+//!
+//! \brief Class of outbound traffic, each class is queued separately and higher classes are served first
+//!
+enum class TransmitPriority
+{
+    COMMAND = 0,
+    TELEMETRY = 1,
+    BULK = 2
+};
+
+#endif // TRANSMIT_PRIORITY_H
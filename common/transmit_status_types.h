@@ -11,7 +11,15 @@ enum class TransmitStatusTypes
     INTERNAL_RESOURCE_ERROR = 0x31,
     INTERNAL_ERROR = 0x32,
     PAYLOAD_TOO_LARGE = 0x74,
-    INDIRECT_MESSAGE_REQUESTED = 0x75
+    INDIRECT_MESSAGE_REQUESTED = 0x75,
+
+    // Generated locally, never reported by the radio
+    TIMEOUT = 0xF0,
+    DROPPED = 0xF1,
+    // replaced by a newer message with the same coalescing key before it was sent
+    SUPERSEDED = 0xF2,
+    // time to live passed while waiting in the transmit queue
+    EXPIRED = 0xF3
 };
 
 